@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "backtest_runner.hpp"
+
+/*
+ * Run many independent replays at once on a thread pool and print the summary of each run.
+ * Usage: OrderBook_backtest <threads> <generated_messages> <dataset.csv | dataset.bin | seed:N | seeds:FIRST-LAST>...
+ * seed:N replays generated_messages messages of the order flow generator with seed N, seeds:FIRST-LAST one run per
+ * seed of the range. threads 0 uses one thread per hardware thread, halved when a .csv dataset needs loader threads.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0]
+                  << " <threads> <generated_messages> <dataset.csv | dataset.bin | seed:N | seeds:FIRST-LAST>..."
+                  << std::endl;
+        return 1;
+    }
+    std::vector<ReplayJob> jobs;
+    size_t thread_count;
+    try {
+        thread_count = std::stoul(argv[1]);
+        uint64_t message_count = std::stoull(argv[2]);
+        if (message_count > OrderFlowGenerator::kMaxMessageCount) {
+            throw std::invalid_argument("generated_messages must be at most " +
+                                        std::to_string(OrderFlowGenerator::kMaxMessageCount) + ".");
+        }
+        for (int i = 3; i < argc; i++) {
+            std::string source = argv[i];
+            uint64_t first_seed;
+            uint64_t last_seed;
+            if (source.starts_with("seed:")) {
+                first_seed = last_seed = std::stoull(source.substr(5));
+            } else if (source.starts_with("seeds:")) {
+                size_t dash = source.find('-', 6);
+                if (dash == std::string::npos) {
+                    throw std::invalid_argument("Seed range must be seeds:FIRST-LAST: " + source);
+                }
+                first_seed = std::stoull(source.substr(6, dash - 6));
+                last_seed = std::stoull(source.substr(dash + 1));
+            } else {
+                jobs.push_back({.dataset = source, .flow = {}, .message_count = 0});
+                continue;
+            }
+            for (uint64_t seed = first_seed; seed <= last_seed; seed++) {
+                jobs.push_back({.dataset = {}, .flow = {.seed = seed}, .message_count = message_count});
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    std::vector<ReplaySummary> summaries = RunReplays(jobs, thread_count);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+    uint64_t total_messages = 0;
+    int failed = 0;
+    std::cout << std::left << std::setw(40) << "source" << std::right << std::setw(12) << "messages" << std::setw(10)
+              << "trades" << std::setw(14) << "ask volume" << std::setw(14) << "bid volume" << std::setw(12)
+              << "M msg/s" << std::endl;
+    for (const ReplaySummary& summary : summaries) {
+        std::cout << std::left << std::setw(40) << summary.source << std::right;
+        if (!summary.error.empty()) {
+            std::cout << "  failed: " << summary.error << std::endl;
+            failed++;
+            continue;
+        }
+        std::cout << std::setw(12) << summary.message_count << std::setw(10) << summary.trade_count << std::setw(14)
+                  << summary.ask_volume << std::setw(14) << summary.bid_volume << std::setw(12) << std::fixed
+                  << std::setprecision(2) << summary.MessagesPerSecond() / 1e6 << std::endl;
+        total_messages += summary.message_count;
+    }
+    std::cout << summaries.size() << " runs, " << failed << " failed, " << total_messages << " messages in "
+              << elapsed.count() << " s, " << total_messages / elapsed.count() / 1e6 << " M messages/s" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+#include "backtest_runner.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+static ReplaySummary RunReplay(const ReplayJob& job) {
+    ReplaySession session;
+    try {
+        if (job.dataset.empty()) {
+            session.ReplayGenerated(job.flow, job.message_count);
+        } else {
+            session.ReplayDataset(job.dataset);
+        }
+    } catch (const std::exception& e) {
+        ReplaySummary summary = session.Summary();
+        summary.source = job.dataset.empty() ? "seed " + std::to_string(job.flow.seed) : job.dataset;
+        summary.error = e.what();
+        return summary;
+    }
+    return session.Summary();
+}
+
+std::vector<ReplaySummary> RunReplays(std::span<const ReplayJob> jobs, size_t thread_count) {
+    if (thread_count == 0) {
+        // a .csv replay runs a loader thread next to its worker, count it so the pool does not oversubscribe the cores
+        bool has_csv = std::any_of(jobs.begin(), jobs.end(), [](const ReplayJob& job) {
+            return !job.dataset.empty() && !job.dataset.ends_with(".bin");
+        });
+        thread_count = std::max<size_t>(1, std::thread::hardware_concurrency() / (has_csv ? 2 : 1));
+    }
+    thread_count = std::min(thread_count, jobs.size());
+
+    // every summary is written by the one worker that took its job, and read after the joins
+    std::vector<ReplaySummary> summaries(jobs.size());
+    std::atomic<size_t> next_job{0};
+    auto worker = [&] {
+        for (size_t job = next_job.fetch_add(1, std::memory_order_relaxed); job < jobs.size();
+             job = next_job.fetch_add(1, std::memory_order_relaxed)) {
+            summaries[job] = RunReplay(jobs[job]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < thread_count; i++) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    return summaries;
+}
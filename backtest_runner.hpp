@@ -0,0 +1,29 @@
+#ifndef BACKTEST_RUNNER_HPP
+#define BACKTEST_RUNNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "dataset_process.hpp"
+#include "order_flow_generator.hpp"
+
+// One independent replay: a dataset file, or a generated flow when dataset is empty.
+struct ReplayJob {
+    std::string dataset;  // .csv or .bin path
+    OrderFlowConfig flow;
+    uint64_t message_count{0};  // messages of the generated flow
+};
+
+/*
+ * Run the jobs on a pool of thread_count worker threads. A worker takes the next job, replays it on a session of its
+ * own and takes the next one, so the sessions never share state and the jobs need no locking. Returns the summary of
+ * every job, in job order. A failing job does not stop the others, its summary has the error.
+ * A .csv job runs a loader thread next to its worker, so thread_count 0 picks one worker per hardware thread, or one
+ * per two hardware threads when any job is a .csv dataset. An explicit thread_count counts the workers only.
+ */
+std::vector<ReplaySummary> RunReplays(std::span<const ReplayJob> jobs, size_t thread_count);
+
+#endif  // BACKTEST_RUNNER_HPP
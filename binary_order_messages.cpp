@@ -0,0 +1,68 @@
+#include "binary_order_messages.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+BinaryMessageWriter::BinaryMessageWriter(const std::string& path)
+    : file_(path, std::ios::binary | std::ios::trunc), path_(path) {
+    if (!file_.is_open()) {
+        throw std::runtime_error("Binary message file open failed " + path);
+    }
+    BinaryFileHeader header{};  // record count is patched on Close()
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!file_) {
+        throw std::runtime_error("Binary message file write failed " + path_);
+    }
+}
+
+BinaryMessageWriter::~BinaryMessageWriter() {
+    try {
+        Close();
+    } catch (const std::exception&) {
+        // a destructor must not throw, call Close() to see write errors
+    }
+}
+
+void BinaryMessageWriter::Write(const OrderMessage& message) {
+    BinaryOrderMessage record = ToBinaryOrderMessage(message);
+    file_.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    if (!file_) {
+        throw std::runtime_error("Binary message file write failed " + path_);
+    }
+    record_count_++;
+}
+
+void BinaryMessageWriter::Close() {
+    if (!file_.is_open()) {
+        return;
+    }
+    BinaryFileHeader header{};
+    std::memcpy(header.magic, kBinaryMessagesMagic, sizeof(header.magic));
+    header.version = kBinaryMessagesVersion;
+    header.record_size = sizeof(BinaryOrderMessage);
+    header.record_count = record_count_;
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_.close();
+    if (!file_) {  // a failed seekp, header write or close
+        throw std::runtime_error("Binary message file write failed " + path_);
+    }
+}
+
+BinaryMessageReader::BinaryMessageReader(const std::string& path) : file_(path) {
+    if (file_.size() < sizeof(BinaryFileHeader)) {
+        throw std::runtime_error("Binary message file too short " + path);
+    }
+    const auto* header = reinterpret_cast<const BinaryFileHeader*>(file_.data());
+    if (std::memcmp(header->magic, kBinaryMessagesMagic, sizeof(header->magic)) != 0) {
+        throw std::runtime_error("Not a binary order message file " + path);
+    }
+    if (header->version != kBinaryMessagesVersion) {
+        throw std::runtime_error("Unsupported binary order message version " + path);
+    }
+    if (header->record_size != sizeof(BinaryOrderMessage) ||
+        header->record_count > (file_.size() - sizeof(BinaryFileHeader)) / sizeof(BinaryOrderMessage)) {
+        throw std::runtime_error("Corrupt binary order message file " + path);
+    }
+    records_ = {reinterpret_cast<const BinaryOrderMessage*>(header + 1), static_cast<size_t>(header->record_count)};
+}
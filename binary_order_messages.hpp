@@ -0,0 +1,110 @@
+#ifndef BINARY_ORDER_MESSAGES_HPP
+#define BINARY_ORDER_MESSAGES_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+
+#include "mapped_file.hpp"
+#include "order.hpp"
+
+/*
+ * Compact binary order message format, replayed without parsing.
+ * A file is a BinaryFileHeader followed by record_count fixed width BinaryOrderMessage records. Every field is
+ * little-endian, so on little-endian hosts the mmapped records are used in place.
+ */
+
+static_assert(std::endian::native == std::endian::little, "binary order messages are mapped in place, little-endian");
+
+inline constexpr char kBinaryMessagesMagic[8] = {'O', 'B', 'M', 'S', 'G', 'S', '\0', '\0'};
+inline constexpr uint32_t kBinaryMessagesVersion = 2;  // 2: order_kind
+
+struct BinaryFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;   // sizeof(BinaryOrderMessage) of the writer, checked by the reader
+    uint64_t record_count;  // number of records after the header
+};
+
+struct BinaryOrderMessage {
+    uint8_t message_type;  // OrderMessageType
+    uint8_t order_type;    // OrderType
+    uint16_t symbol_id;    // SymbolId, zero in single instrument files
+    uint8_t order_kind;    // OrderKind
+    uint8_t reserved;
+    uint16_t owner_id;  // OwnerId, zero when the orders have no owner
+    uint32_t order_id;
+    uint32_t price;
+    uint32_t quantity;
+    uint32_t lower_price;  // For GetAskVolumeBetweenPrices
+    uint32_t upper_price;  // For GetAskVolumeBetweenPrices
+};
+
+static_assert(sizeof(BinaryFileHeader) == 24);
+static_assert(sizeof(BinaryOrderMessage) == 28);
+
+inline BinaryOrderMessage ToBinaryOrderMessage(const OrderMessage& message) {
+    return {static_cast<uint8_t>(message.order_message_type),
+            static_cast<uint8_t>(message.order.order_type),
+            message.symbol_id,
+            static_cast<uint8_t>(message.order.kind),
+            0,
+            message.order.owner_id,
+            message.order.orderId,
+            message.order.price,
+            message.order.quantity,
+            static_cast<uint32_t>(message.lower_price),
+            static_cast<uint32_t>(message.upper_price)};
+}
+
+inline OrderMessage ToOrderMessage(const BinaryOrderMessage& record) {
+    OrderMessage message;
+    message.order_message_type = static_cast<OrderMessageType>(record.message_type);
+    message.order = {static_cast<OrderType>(record.order_type), record.order_id, record.price, record.quantity,
+                     static_cast<OrderKind>(record.order_kind), record.owner_id};
+    message.lower_price = static_cast<int>(record.lower_price);
+    message.upper_price = static_cast<int>(record.upper_price);
+    message.symbol_id = record.symbol_id;
+    return message;
+}
+
+/*
+ * Writes order messages to a binary file. The record count in the header is patched on Close(). Throws
+ * std::runtime_error if the file cannot be written.
+ */
+class BinaryMessageWriter {
+   public:
+    explicit BinaryMessageWriter(const std::string& path);
+    ~BinaryMessageWriter();
+
+    BinaryMessageWriter(const BinaryMessageWriter&) = delete;
+    BinaryMessageWriter& operator=(const BinaryMessageWriter&) = delete;
+
+    void Write(const OrderMessage& message);
+    void Close();
+    uint64_t RecordCount() const { return record_count_; }
+
+   private:
+    std::ofstream file_;
+    std::string path_;
+    uint64_t record_count_{};
+};
+
+/*
+ * Maps a binary order message file read-only, the records are handed out in place.
+ */
+class BinaryMessageReader {
+   public:
+    explicit BinaryMessageReader(const std::string& path);
+
+    std::span<const BinaryOrderMessage> Records() const { return records_; }
+
+   private:
+    MappedFile file_;
+    std::span<const BinaryOrderMessage> records_;
+};
+
+#endif  // BINARY_ORDER_MESSAGES_HPP
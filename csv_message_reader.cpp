@@ -0,0 +1,293 @@
+#include "csv_message_reader.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+/*
+ * Splits a line on commas in place.
+ */
+class FieldCursor {
+   public:
+    explicit FieldCursor(std::string_view line)
+        : line_(line), cursor_(line.data()), end_(line.data() + line.size()) {}
+
+    std::string_view NextField() {
+        const char* comma = static_cast<const char*>(std::memchr(cursor_, ',', end_ - cursor_));
+        const char* field_end = comma == nullptr ? end_ : comma;
+        std::string_view field(cursor_, field_end - cursor_);
+        cursor_ = comma == nullptr ? end_ : comma + 1;
+        fields_read_++;
+        return field;
+    }
+
+    // A required number, throws std::invalid_argument if the field is empty, malformed or out of range.
+    uint32_t NextNumber(uint32_t max = UINT32_MAX) {
+        std::string_view field = NextField();
+        uint32_t value = 0;
+        auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+        if (field.empty() || error != std::errc{} || end != field.data() + field.size() || value > max) {
+            throw std::invalid_argument("Malformed order message line: " + std::string(line_));
+        }
+        return value;
+    }
+
+    // An optional number, 0 when the field is empty or missing.
+    uint32_t NextOptionalNumber(uint32_t max = UINT32_MAX) {
+        if (cursor_ < end_ && *cursor_ != ',') return NextNumber(max);
+        NextField();
+        return 0;
+    }
+
+    void Skip(int field_count) {
+        for (int i = 0; i < field_count; i++) NextField();
+    }
+
+    // Skip the fields before the zero based field index.
+    void SkipTo(size_t index) {
+        while (fields_read_ < index && cursor_ < end_) NextField();
+    }
+
+   private:
+    std::string_view line_;
+    const char* cursor_;
+    const char* end_;
+    size_t fields_read_{0};
+};
+
+// Message Type, Order ID, Order Type, Price, Quantity, Lower Price, Upper Price, Symbol, Order Kind, Owner
+constexpr size_t kSymbolField = 7;
+
+OrderType ParseOrderType(std::string_view field) {
+    if (field.starts_with("buy")) return OrderType::BUY;
+    if (field.starts_with("sell")) return OrderType::SELL;
+    return OrderType::UNDEFINED;
+}
+
+OrderKind ParseOrderKind(std::string_view field) {
+    if (field.starts_with("market")) return OrderKind::MARKET;
+    if (field.starts_with("ioc")) return OrderKind::IOC;
+    if (field.starts_with("fok")) return OrderKind::FOK;
+    return OrderKind::LIMIT;
+}
+
+const char* OrderTypeName(OrderType type) {
+    switch (type) {
+        case OrderType::BUY:
+            return "buy";
+        case OrderType::SELL:
+            return "sell";
+        default:
+            return "undefined";
+    }
+}
+
+const char* OrderKindName(OrderKind kind) {
+    switch (kind) {
+        case OrderKind::MARKET:
+            return "market";
+        case OrderKind::IOC:
+            return "ioc";
+        case OrderKind::FOK:
+            return "fok";
+        default:
+            return "limit";
+    }
+}
+
+void AppendNumber(std::string& out, uint64_t value) {
+    char digits[20];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, end);
+}
+
+}  // namespace
+
+OrderMessage ParseOrderMessageLine(std::string_view line) {
+    OrderMessage next_order_msg;
+    FieldCursor fields(line);
+    std::string_view order_message_type_str = fields.NextField();
+
+    // The message type is dispatched on its first bytes: AddOrder, CancelOrder, ModifyOrder, MassCancel, GetBestBid,
+    // GetAskVolumeBetweenPrices.
+    if (order_message_type_str.starts_with("Add")) {
+        next_order_msg.order_message_type = OrderMessageType::ADD_ORDER;
+        next_order_msg.order.orderId = fields.NextNumber();
+        next_order_msg.order.order_type = ParseOrderType(fields.NextField());
+        next_order_msg.order.price = fields.NextNumber();
+        next_order_msg.order.quantity = fields.NextNumber();
+    } else if (order_message_type_str.starts_with("Cancel")) {
+        // For cancel order we fill the Order msg type and order id, other fields will not be used.
+        next_order_msg.order_message_type = OrderMessageType::CANCEL_ORDER;
+        next_order_msg.order.orderId = fields.NextNumber();
+    } else if (order_message_type_str.starts_with("Modify")) {
+        // The order keeps its side, the order type field may be empty.
+        next_order_msg.order_message_type = OrderMessageType::MODIFY_ORDER;
+        next_order_msg.order.orderId = fields.NextNumber();
+        next_order_msg.order.order_type = ParseOrderType(fields.NextField());
+        next_order_msg.order.price = fields.NextNumber();
+        next_order_msg.order.quantity = fields.NextNumber();
+    } else if (order_message_type_str.starts_with("Mass")) {
+        // The owner column selects the orders, without an owner the side and price select the levels.
+        next_order_msg.order_message_type = OrderMessageType::MASS_CANCEL;
+        fields.Skip(1);  // order id is empty
+        next_order_msg.order.order_type = ParseOrderType(fields.NextField());
+        next_order_msg.order.price = fields.NextNumber();
+    } else if (order_message_type_str.starts_with("GetB")) {
+        next_order_msg.order_message_type = OrderMessageType::GET_BEST_BID;
+    } else if (order_message_type_str.starts_with("GetA")) {
+        next_order_msg.order_message_type = OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES;
+        fields.Skip(4);  // order id, order type, price and quantity are empty
+        next_order_msg.lower_price = static_cast<int>(fields.NextNumber(INT32_MAX));
+        next_order_msg.upper_price = static_cast<int>(fields.NextNumber(INT32_MAX));
+    } else {
+        throw std::invalid_argument("Unknown order message type: " + std::string(line));
+    }
+    // Optional trailing Symbol column of multi instrument datasets, symbol 0 when absent.
+    fields.SkipTo(kSymbolField);
+    next_order_msg.symbol_id = static_cast<SymbolId>(fields.NextOptionalNumber(UINT16_MAX));
+    // Optional Order Kind column after it, limit orders when absent.
+    next_order_msg.order.kind = ParseOrderKind(fields.NextField());
+    // Optional Owner column last, no owner when absent.
+    next_order_msg.order.owner_id = static_cast<OwnerId>(fields.NextOptionalNumber(UINT16_MAX));
+    return next_order_msg;
+}
+
+CsvMessageReader::CsvMessageReader(const std::string& path) : file_(path) {
+    cursor_ = file_.data();
+    end_ = file_.data() + file_.size();
+    if (cursor_ == end_) {
+        return;  // empty file
+    }
+    // skip the header
+    const char* newline = static_cast<const char*>(std::memchr(cursor_, '\n', end_ - cursor_));
+    cursor_ = newline == nullptr ? end_ : newline + 1;
+}
+
+bool CsvMessageReader::Next(OrderMessage& order_message) {
+    while (cursor_ < end_) {
+        const char* newline = static_cast<const char*>(std::memchr(cursor_, '\n', end_ - cursor_));
+        const char* line_end = newline == nullptr ? end_ : newline;
+        std::string_view line(cursor_, line_end - cursor_);
+        cursor_ = newline == nullptr ? end_ : newline + 1;
+
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);  // csv module writes \r\n line endings
+        if (line.empty()) continue;
+        order_message = ParseOrderMessageLine(line);
+        return true;
+    }
+    return false;
+}
+
+bool CsvMessageReader::Skip() {
+    while (cursor_ < end_) {
+        const char* newline = static_cast<const char*>(std::memchr(cursor_, '\n', end_ - cursor_));
+        const char* line_end = newline == nullptr ? end_ : newline;
+        bool empty = line_end == cursor_ || (line_end == cursor_ + 1 && *cursor_ == '\r');
+        cursor_ = newline == nullptr ? end_ : newline + 1;
+        if (!empty) {
+            return true;
+        }
+    }
+    return false;
+}
+
+CsvMessageWriter::CsvMessageWriter(const std::string& path)
+    : file_(path, std::ios::binary | std::ios::trunc), path_(path) {
+    if (!file_.is_open()) {
+        throw std::runtime_error("File open failed " + path);
+    }
+    buffer_.reserve(kBufferSize + 256);
+    buffer_ = "Message Type,Order ID,Order Type,Price,Quantity,Lower Price,Upper Price\n";
+}
+
+CsvMessageWriter::~CsvMessageWriter() {
+    try {
+        Close();
+    } catch (const std::exception&) {
+        // a destructor must not throw, call Close() to see write errors
+    }
+}
+
+void CsvMessageWriter::Write(const OrderMessage& order_message) {
+    const Order& order = order_message.order;
+    switch (order_message.order_message_type) {
+        case OrderMessageType::ADD_ORDER:
+        case OrderMessageType::MODIFY_ORDER:
+            buffer_ += order_message.order_message_type == OrderMessageType::ADD_ORDER ? "AddOrder," : "ModifyOrder,";
+            AppendNumber(buffer_, order.orderId);
+            buffer_ += ',';
+            if (order_message.order_message_type == OrderMessageType::ADD_ORDER) {
+                buffer_ += OrderTypeName(order.order_type);
+            }
+            buffer_ += ',';
+            AppendNumber(buffer_, order.price);
+            buffer_ += ',';
+            AppendNumber(buffer_, order.quantity);
+            buffer_ += ",,";
+            break;
+        case OrderMessageType::CANCEL_ORDER:
+            buffer_ += "CancelOrder,";
+            AppendNumber(buffer_, order.orderId);
+            buffer_ += ",,,,,";
+            break;
+        case OrderMessageType::MASS_CANCEL:
+            buffer_ += "MassCancel,,";
+            buffer_ += OrderTypeName(order.order_type);
+            buffer_ += ',';
+            AppendNumber(buffer_, order.price);
+            buffer_ += ",,,";
+            break;
+        case OrderMessageType::GET_BEST_BID:
+            buffer_ += "GetBestBid,,,,,,";
+            break;
+        case OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES:
+            buffer_ += "GetAskVolumeBetweenPrices,,,,,";
+            AppendNumber(buffer_, static_cast<uint32_t>(order_message.lower_price));
+            buffer_ += ',';
+            AppendNumber(buffer_, static_cast<uint32_t>(order_message.upper_price));
+            break;
+        default:
+            return;  // undefined messages have no line
+    }
+    if (order_message.symbol_id != 0 || order.kind != OrderKind::LIMIT || order.owner_id != 0) {
+        buffer_ += ',';
+        AppendNumber(buffer_, order_message.symbol_id);
+        if (order.kind != OrderKind::LIMIT || order.owner_id != 0) {
+            buffer_ += ',';
+            buffer_ += OrderKindName(order.kind);
+        }
+        if (order.owner_id != 0) {
+            buffer_ += ',';
+            AppendNumber(buffer_, order.owner_id);
+        }
+    }
+    buffer_ += '\n';
+    record_count_++;
+    if (buffer_.size() >= kBufferSize) {
+        FlushBuffer();
+    }
+}
+
+void CsvMessageWriter::Close() {
+    if (!file_.is_open()) {
+        return;
+    }
+    FlushBuffer();
+    file_.close();
+    if (!file_) {
+        throw std::runtime_error("File write failed " + path_);
+    }
+}
+
+void CsvMessageWriter::FlushBuffer() {
+    file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+    if (!file_) {
+        throw std::runtime_error("File write failed " + path_);
+    }
+}
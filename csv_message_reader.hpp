@@ -0,0 +1,72 @@
+#ifndef CSV_MESSAGE_READER_HPP
+#define CSV_MESSAGE_READER_HPP
+
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "mapped_file.hpp"
+#include "order.hpp"
+
+/*
+ * Parse one line of the .csv file created by the data_generator.py into an order message. The line is scanned in
+ * place and the numbers are parsed with std::from_chars, nothing is allocated. An optional eighth column holds the
+ * symbol id of multi instrument datasets, an optional ninth the order kind of an AddOrder (limit, market, ioc, fok)
+ * and an optional tenth the owner id of an AddOrder or MassCancel. Throws std::invalid_argument for an unknown message
+ * type or a required number that is empty, malformed or out of range, the line is not handed to a book with zeros.
+ */
+OrderMessage ParseOrderMessageLine(std::string_view line);
+
+/*
+ * Streaming reader of an order message .csv file. The file is memory mapped, lines and fields are found in place
+ * (memchr, which is vectorized by the C library where the CPU supports it), so reading does not allocate per line.
+ * Throws std::runtime_error if the file cannot be opened.
+ */
+class CsvMessageReader {
+   public:
+    explicit CsvMessageReader(const std::string& path);
+
+    // Parse the next message into order_message, false when the end of the file is reached. Throws
+    // std::invalid_argument for a malformed line, see ParseOrderMessageLine().
+    bool Next(OrderMessage& order_message);
+
+    // Skip the next message without parsing it, false when the end of the file is reached.
+    bool Skip();
+
+   private:
+    MappedFile file_;
+    const char* cursor_;
+    const char* end_;
+};
+
+/*
+ * Writes order messages as .csv lines in the format of the data_generator.py, read back by CsvMessageReader. The
+ * Symbol, Order Kind and Owner columns are only written for the messages that need them. Lines are formatted with
+ * std::to_chars into a buffer that is written in large blocks. Throws std::runtime_error if the file cannot be written.
+ */
+class CsvMessageWriter {
+   public:
+    explicit CsvMessageWriter(const std::string& path);
+    ~CsvMessageWriter();
+
+    CsvMessageWriter(const CsvMessageWriter&) = delete;
+    CsvMessageWriter& operator=(const CsvMessageWriter&) = delete;
+
+    void Write(const OrderMessage& order_message);
+    // Write the buffered lines and close the file.
+    void Close();
+
+    uint64_t RecordCount() const { return record_count_; }
+
+   private:
+    static constexpr size_t kBufferSize = size_t{1} << 20;
+
+    void FlushBuffer();
+
+    std::ofstream file_;
+    std::string path_;
+    std::string buffer_;
+    uint64_t record_count_{0};
+};
+
+#endif  // CSV_MESSAGE_READER_HPP
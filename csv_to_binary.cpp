@@ -0,0 +1,32 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "binary_order_messages.hpp"
+#include "csv_message_reader.hpp"
+
+/*
+ * Convert an order message .csv file (created by the data_generator.py) to the binary format of
+ * binary_order_messages.hpp, so replays skip the text parsing.
+ * Usage: OrderBook_csv_to_binary <input.csv> <output.bin>
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cout << "Usage: " << argv[0] << " <input.csv> <output.bin>" << std::endl;
+        return 1;
+    }
+    try {
+        CsvMessageReader reader(argv[1]);
+        BinaryMessageWriter writer(argv[2]);
+        OrderMessage order_message;
+        while (reader.Next(order_message)) {
+            writer.Write(order_message);
+        }
+        writer.Close();
+        std::cout << "Converted " << writer.RecordCount() << " order messages to " << argv[2] << std::endl;
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,117 +1,301 @@
 #include "dataset_process.hpp"
 
-#include <boost/lockfree/spsc_queue.hpp>
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
-#include <sstream>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "binary_order_messages.hpp"
+#include "csv_message_reader.hpp"
+#include "ingest_sequencer.hpp"
+#include "latency_stats.hpp"
+#include "matching_engine.hpp"
 #include "order.hpp"
 #include "order_book.hpp"
-#include "order_utilities.hpp"
-
-boost::lockfree::spsc_queue<OrderMessage> order_messages(1024);
-OrderBook order_book;
-std::atomic<bool> read_in_is_done;
-uint32_t debug_dummy_volume_ask = 0;
-uint32_t debug_dummy_volume_bid = 0;
-std::string filename = "../example_order_dataset/example_dataset.csv";
-
-// Preprocessor macro definitions
-#ifdef ENABLE_DEBUG_PRINTS
-#define DEBUG_PRINT(x) std::cout << x << std::endl;
-#else
-#define DEBUG_PRINT(x) \
-    do {               \
-    } while (0)
+
+namespace {
+
+constexpr size_t kPacketSize = 128;
+
+// Adds the wall time of its scope to the seconds of a summary.
+class ReplayTimer {
+   public:
+    explicit ReplayTimer(ReplaySummary& summary)
+        : summary_(summary), start_time_(std::chrono::steady_clock::now()) {}
+    ~ReplayTimer() {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time_;
+        summary_.seconds += elapsed.count();
+    }
+
+   private:
+    ReplaySummary& summary_;
+    std::chrono::steady_clock::time_point start_time_;
+};
+
+#ifdef ENABLE_LATENCY_STATS
+/*
+ * Record the time the messages of a popped packet spent between parsing and processing.
+ */
+void RecordQueueWait(std::span<const OrderMessage> packet) {
+    uint64_t now = ReadTsc();
+    LatencyRecorder& recorder = ThreadLatencyRecorder();
+    for (const OrderMessage& message : packet) {
+        recorder.RecordQueueWait(message.order_message_type, now - message.receive_tsc);
+    }
+}
 #endif
 
+}  // namespace
+
+/*
+ * Count the trades of the execution reports queued by the book. Called on the matching thread between packets, a
+ * packet produces far fewer reports than the ring holds so none is dropped.
+ */
+void ReplaySession::DrainEvents() {
+    book_.GetEventSink().Drain([this](const BookEvent& event) {
+        if (event.type == BookEventType::TRADE) {
+            summary_.trade_count++;
+        }
+    });
+    summary_.dropped_reports = book_.GetEventSink().DroppedCount();
+}
+
 /*
- * Load the simulated traffic: order messages from a the .csv file created by the data_generator.py to a vector.
+ * Add the query results of an applied packet to the volumes.
  */
-void LoadOrdersFromCSV() {
-    std::ifstream file(filename);
-
-    if (file.is_open()) {
-        DEBUG_PRINT("Example Dataset opened " << filename);
-        std::string line;
-        std::getline(file, line);  // skip the header
-
-        while (std::getline(file, line)) {
-            std::string word;
-            std::stringstream ss(line);
-            OrderMessage next_order_msg;
-            std::string order_message_type_str;
-
-            std::getline(ss, order_message_type_str, ',');
-            if (order_message_type_str == "CancelOrder") {
-                // For cancel order we fill the Order msg type and order id, other fields will not be used.
-                next_order_msg.order_message_type = OrderMessageType::CANCEL_ORDER;
-
-                std::getline(ss, word, ',');
-                next_order_msg.order.orderId = std::stoi(word);
-            } else if (order_message_type_str == "AddOrder") {
-                next_order_msg.order_message_type = OrderMessageType::ADD_ORDER;
-
-                // Fill out the Order part of the Order Message struct.
-                std::getline(ss, word, ',');
-                next_order_msg.order.orderId = std::stoi(word);
-
-                std::getline(ss, word, ',');
-                next_order_msg.order.order_type = StringToOrderType(word);
-
-                std::getline(ss, word, ',');
-                next_order_msg.order.price = std::stoi(word);
-
-                std::getline(ss, word, ',');
-                next_order_msg.order.quantity = std::stoi(word);
-            } else if (order_message_type_str == "GetBestBid") {
-                next_order_msg.order_message_type = OrderMessageType::GET_BEST_BID;
-            } else if (order_message_type_str == "GetAskVolumeBetweenPrices") {
-                next_order_msg.order_message_type = OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES;
-                do {
-                    std::getline(ss, word, ',');  // skip empty lines
-                } while (word.empty());
-                next_order_msg.lower_price = std::stoi(word);
-                std::getline(ss, word, ',');
-                next_order_msg.upper_price = std::stoi(word);
+void ReplaySession::AccumulateQueryResults(std::span<const OrderMessage> packet,
+                                           std::span<const MessageResult> results) {
+    for (size_t i = 0; i < packet.size(); i++) {
+        if (packet[i].order_message_type == OrderMessageType::GET_BEST_BID) {
+            summary_.bid_volume += results[i].quantity;
+        } else if (packet[i].order_message_type == OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES) {
+            summary_.ask_volume += results[i].quantity;
+        }
+    }
+}
+
+void ReplaySession::ApplyPacket(std::span<const OrderMessage> packet) {
+    std::array<MessageResult, kPacketSize> results;
+    book_.Apply(packet, {results.data(), packet.size()});
+    AccumulateQueryResults(packet, {results.data(), packet.size()});
+    summary_.message_count += packet.size();
+    DrainEvents();
+}
+
+/*
+ * Execute one order message on the book.
+ */
+void ReplaySession::ExecuteOrderMessage(const OrderMessage& next_order_msg) {
+    if (next_order_msg.order_message_type == OrderMessageType::CANCEL_ORDER) {
+        book_.CancelOrderbyId(next_order_msg.order.orderId);
+    } else if (next_order_msg.order_message_type == OrderMessageType::ADD_ORDER) {
+        book_.AddOrder(next_order_msg.order);
+    } else if (next_order_msg.order_message_type == OrderMessageType::MODIFY_ORDER) {
+        book_.ModifyOrder(next_order_msg.order.orderId, next_order_msg.order.price, next_order_msg.order.quantity);
+    } else if (next_order_msg.order_message_type == OrderMessageType::MASS_CANCEL) {
+        const Order& order = next_order_msg.order;
+        if (order.owner_id != 0) {
+            book_.CancelOwnerOrders(order.owner_id, order.order_type);
+        } else {
+            book_.CancelLevelsFrom(order.order_type, order.price);
+        }
+    } else if (next_order_msg.order_message_type == OrderMessageType::GET_BEST_BID) {
+        summary_.bid_volume += book_.GetBestBidWithQuantity().second;
+    } else if (next_order_msg.order_message_type == OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES) {
+        summary_.ask_volume += book_.GetVolumeBetweenPrices(next_order_msg.lower_price, next_order_msg.upper_price);
+    }
+    summary_.message_count++;
+    DrainEvents();
+}
+
+/*
+ * Load the simulated traffic: order messages from a the .csv file created by the data_generator.py into the channel,
+ * in batches. A full channel blocks the loader, no message is dropped. The channel is closed at the end of the file.
+ * The file is memory mapped and parsed in place, see CsvMessageReader.
+ */
+std::string ReplaySession::LoadOrdersFromCSV(const std::string& path, OrderMessageChannel& channel) {
+    constexpr size_t kBatchSize = 64;
+    std::array<OrderMessage, kBatchSize> batch;
+    std::string error;
+    try {
+        CsvMessageReader reader(path);
+        DEBUG_PRINT("Example Dataset opened " << path);
+
+        size_t count = 0;
+        while (reader.Next(batch[count])) {
+            LATENCY_STATS(batch[count].receive_tsc = ReadTsc());
+            if (++count == kBatchSize) {
+                channel.Push(batch);
+                count = 0;
             }
+        }
+        channel.Push({batch.data(), count});
+    } catch (const std::runtime_error&) {
+        error = "Example Dataset File open failed " + path;
+    } catch (const std::invalid_argument& e) {
+        error = e.what();  // malformed line
+    }
+    channel.Close();
+    return error;
+}
+
+/*
+ * Apply the order messages of the channel to the book in the batches they arrive in, until the channel is closed and
+ * every message has been applied.
+ */
+void ReplaySession::ProcessOrderMessages(OrderMessageChannel& channel) {
+    std::array<OrderMessage, kPacketSize> packet;
+    while (size_t count = channel.Pop(packet)) {
+        LATENCY_STATS(RecordQueueWait({packet.data(), count}));
+        ApplyPacket({packet.data(), count});
+    }
+}
+
+void ReplaySession::ReplayCsv(const std::string& path) {
+    summary_.source = path;
+    ReplayTimer timer(summary_);
+    OrderMessageChannel order_messages(kOrderMessageChannelCapacity);
+    std::thread producer_thread{[&] { summary_.error = LoadOrdersFromCSV(path, order_messages); }};
+    ProcessOrderMessages(order_messages);
+    producer_thread.join();
+}
 
-            order_messages.push(next_order_msg);
+/*
+ * The file is mmapped and the fixed width records are handed to the book in packets through OrderBook::Apply, without
+ * any parsing.
+ */
+void ReplaySession::ReplayBinary(const std::string& path) {
+    summary_.source = path;
+    ReplayTimer timer(summary_);
+    std::array<OrderMessage, kPacketSize> packet;
+
+    BinaryMessageReader reader(path);
+    std::span<const BinaryOrderMessage> records = reader.Records();
+    for (size_t first = 0; first < records.size(); first += kPacketSize) {
+        size_t count = std::min(kPacketSize, records.size() - first);
+        for (size_t i = 0; i < count; i++) {
+            packet[i] = ToOrderMessage(records[first + i]);
         }
-        file.close();
+        ApplyPacket({packet.data(), count});
+    }
+}
+
+void ReplaySession::ReplayDataset(const std::string& path) {
+    if (path.ends_with(".bin")) {
+        ReplayBinary(path);
     } else {
-        std::cout << "Example Dataset File open failed " << filename << std::endl;
+        ReplayCsv(path);
     }
-    read_in_is_done = true;
 }
 
-void ProcessOrderMessages() {
-    while (!read_in_is_done) {
-        // check if single producer single consumer data queue has messages to consume
-        if (order_messages.read_available() == 0) {
-            std::this_thread::sleep_for(std::chrono::microseconds(10));
+/*
+ * The calling thread submits the messages and consumes the merged results, the trades are counted from the merged
+ * execution reports.
+ */
+void ReplaySession::ReplayThroughEngine(const std::string& path, size_t shard_count) {
+    summary_.source = path;
+    ReplayTimer timer(summary_);
+    MatchingEngine engine(MatchingEngineConfig{.shard_count = shard_count});
+    auto accumulate = [this](const SequencedResult& sequenced) {
+        if (sequenced.message_type == OrderMessageType::GET_BEST_BID) {
+            summary_.bid_volume += sequenced.result.quantity;
+        } else if (sequenced.message_type == OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES) {
+            summary_.ask_volume += sequenced.result.quantity;
         }
+    };
+    auto count_trades = [this](const SequencedReport& report) {
+        if (report.event.type == BookEventType::TRADE) {
+            summary_.trade_count++;
+        }
+    };
+
+    BinaryMessageReader reader(path);
+    for (const BinaryOrderMessage& record : reader.Records()) {
+        engine.Submit(ToOrderMessage(record), accumulate, count_trades);
+    }
+    engine.Flush(accumulate, count_trades);
+    summary_.message_count += reader.Records().size();
+}
 
-        // get next order message from spsc queu
-        OrderMessage next_order_msg;
-        order_messages.pop(next_order_msg);
+/*
+ * The way orders arrive from several gateway sessions: session s publishes the blocks of 64 lines with block index %
+ * session_count == s, timestamped with their line number, from its own thread. The calling thread merges the sessions
+ * through the IngestSequencer, which restores the file order whatever the thread timing, and applies the sequenced
+ * messages to the book.
+ */
+void ReplaySession::ReplayFromSessions(const std::string& path, size_t session_count) {
+    summary_.source = path;
+    ReplayTimer timer(summary_);
+    constexpr size_t kBlockSize = 64;
+    IngestSequencer<> sequencer(session_count, kOrderMessageChannelCapacity);
+    std::vector<std::string> errors(session_count);
+
+    auto feed_session = [&sequencer, &errors, &path, session_count](size_t session) {
+        std::array<IngestMessage, kBlockSize> block;
+        try {
+            CsvMessageReader reader(path);
+            uint64_t line = 0;
+            for (bool more = true; more;) {
+                bool mine = (line / kBlockSize) % session_count == session;
+                size_t count = 0;
+                for (; count < kBlockSize; count++, line++) {
+                    more = mine ? reader.Next(block[count].message) : reader.Skip();
+                    if (!more) break;
+                    block[count].timestamp = line;
+                    LATENCY_STATS(block[count].message.receive_tsc = ReadTsc());
+                }
+                if (mine) {
+                    sequencer.Publish(session, {block.data(), count});
+                }
+            }
+        } catch (const std::runtime_error&) {
+            errors[session] = "Example Dataset File open failed " + path;
+        } catch (const std::invalid_argument& e) {
+            errors[session] = e.what();  // malformed line
+        }
+        sequencer.Close(session);
+    };
+    std::vector<std::thread> session_threads;
+    for (size_t session = 0; session < session_count; session++) {
+        session_threads.emplace_back(feed_session, session);
+    }
 
-        if (next_order_msg.order_message_type == OrderMessageType::CANCEL_ORDER) {
-            order_book.CancelOrderbyId(next_order_msg.order.orderId);
-        } else if (next_order_msg.order_message_type == OrderMessageType::ADD_ORDER) {
-            order_book.AddOrder(next_order_msg.order);
+    std::array<SequencedMessage, kPacketSize> sequenced;
+    std::array<OrderMessage, kPacketSize> packet;
+    while (!sequencer.Done()) {
+        size_t count = sequencer.Poll(sequenced);
+        if (count == 0) {
+            std::this_thread::yield();
+            continue;
         }
-        // Make sure compiler does not optimize by volatile flag (during benchmark where no dummy).
-        else if (next_order_msg.order_message_type == OrderMessageType::GET_BEST_BID) {
-            volatile std::pair<int, int> my_pair = order_book.GetBestBidWithQuantity();
-            debug_dummy_volume_bid += my_pair.second;
-        } else if (next_order_msg.order_message_type == OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES) {
-            volatile uint32_t askVolume =
-                order_book.GetVolumeBetweenPrices(next_order_msg.lower_price, next_order_msg.upper_price);
-            debug_dummy_volume_ask += askVolume;
+        for (size_t i = 0; i < count; i++) {
+            packet[i] = sequenced[i].message;
         }
+        LATENCY_STATS(RecordQueueWait({packet.data(), count}));
+        ApplyPacket({packet.data(), count});
+    }
+    for (std::thread& thread : session_threads) {
+        thread.join();
+    }
+    for (const std::string& error : errors) {
+        if (!error.empty()) summary_.error = error;
     }
-}
\ No newline at end of file
+}
+
+void ReplaySession::ReplayGenerated(const OrderFlowConfig& config, uint64_t message_count) {
+    summary_.source = "seed " + std::to_string(config.seed);
+    ReplayTimer timer(summary_);
+    OrderFlowGenerator generator(config);
+    std::array<OrderMessage, kPacketSize> packet;
+    for (uint64_t left = message_count; left > 0;) {
+        size_t count = std::min<uint64_t>(left, packet.size());
+        generator.Next({packet.data(), count});
+        ApplyPacket({packet.data(), count});
+        left -= count;
+    }
+}
@@ -1,22 +1,73 @@
 #ifndef DATASET_PROCESS_HPP
 #define DATASET_PROCESS_HPP
 
-#include <atomic>
-#include <boost/lockfree/spsc_queue.hpp>
+#include <cstdint>
+#include <span>
 #include <string>
 
 #include "order.hpp"
 #include "order_book.hpp"
+#include "order_flow_generator.hpp"
+#include "spsc_channel.hpp"
 
-// Declare global variables using extern
-extern boost::lockfree::spsc_queue<OrderMessage> order_messages;
-extern OrderBook order_book;
-extern std::atomic<bool> read_in_is_done;
-extern uint32_t debug_dummy_volume_ask;
-extern uint32_t debug_dummy_volume_bid;
-extern std::string filename;
+// Hand-off of parsed order messages from the loader thread to the processing thread.
+using OrderMessageChannel = SpscChannel<OrderMessage, SpinThenYieldWait>;
+inline constexpr size_t kOrderMessageChannelCapacity = 4096;
 
-void ProcessOrderMessages();
-void LoadOrdersFromCSV();
+// Totals of one replay.
+struct ReplaySummary {
+    std::string source;  // dataset path or generated flow
+    uint64_t message_count{0};
+    uint64_t trade_count{0};
+    uint64_t ask_volume{0};       // sum of the GetAskVolumeBetweenPrices results
+    uint64_t bid_volume{0};       // sum of the GetBestBid quantities
+    uint64_t dropped_reports{0};  // execution reports lost by the book's ring
+    double seconds{0};
+    std::string error;  // why the replay failed, empty on success
+
+    double MessagesPerSecond() const { return seconds > 0 ? message_count / seconds : 0; }
+};
+
+/*
+ * One replay of order messages: its book and the totals of the messages applied to it. Nothing is shared between
+ * sessions, so independent replays run at the same time on different threads (see backtest_runner.hpp), each session
+ * used by one thread at a time. The book's execution reports are drained and counted on the matching thread after
+ * every packet. A session replays one source, its book is not reset between replays.
+ */
+class ReplaySession {
+   public:
+    OrderBook& Book() { return book_; }
+    const ReplaySummary& Summary() const { return summary_; }
+
+    // Execute one order message on the book, through the single message calls of the OrderBook.
+    void ExecuteOrderMessage(const OrderMessage& next_order_msg);
+
+    // A .csv dataset parsed by a loader thread, and processed on the calling thread.
+    void ReplayCsv(const std::string& path);
+    // A .bin dataset (see binary_order_messages.hpp) replayed from a memory mapping on the calling thread.
+    void ReplayBinary(const std::string& path);
+    // ReplayBinary() or ReplayCsv(), by file extension.
+    void ReplayDataset(const std::string& path);
+    // A .csv dataset fed by session_count concurrent feed sessions, merged by the ingest sequencer.
+    void ReplayFromSessions(const std::string& path, size_t session_count);
+    // A .bin dataset on a multi instrument engine with shard_count matching threads, one book per symbol. The
+    // session's book is not used.
+    void ReplayThroughEngine(const std::string& path, size_t shard_count);
+    // A generated flow of message_count messages streamed into the book, without a file.
+    void ReplayGenerated(const OrderFlowConfig& config, uint64_t message_count);
+
+    // The loader thread of ReplayCsv(): parse the dataset into the channel and close it. Returns the error, if any.
+    static std::string LoadOrdersFromCSV(const std::string& path, OrderMessageChannel& channel);
+    // The processing of ReplayCsv(): apply the messages of the channel until it is closed and drained.
+    void ProcessOrderMessages(OrderMessageChannel& channel);
+
+   private:
+    void ApplyPacket(std::span<const OrderMessage> packet);
+    void AccumulateQueryResults(std::span<const OrderMessage> packet, std::span<const MessageResult> results);
+    void DrainEvents();
+
+    OrderBook book_;
+    ReplaySummary summary_;
+};
 
 #endif  // DATASET_PROCESS_HPP
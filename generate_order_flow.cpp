@@ -0,0 +1,71 @@
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "binary_order_messages.hpp"
+#include "csv_message_reader.hpp"
+#include "order_book.hpp"
+#include "order_flow_generator.hpp"
+
+/*
+ * Generate a synthetic order flow (order_flow_generator.hpp) into a .csv or .bin dataset, or stream it straight into a
+ * book without a file ("replay") and report the matching throughput.
+ * Usage: OrderBook_generate_flow <message_count> <output.csv | output.bin | replay> [seed] [cancel_weight]
+ *        [book_depth] [burstiness]
+ * The defaults reproduce the message mix of data_generator.py, seed 1.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 7) {
+        std::cout << "Usage: " << argv[0]
+                  << " <message_count> <output.csv | output.bin | replay> [seed] [cancel_weight] [book_depth]"
+                     " [burstiness]"
+                  << std::endl;
+        return 1;
+    }
+    try {
+        uint64_t message_count = std::stoull(argv[1]);
+        if (message_count > OrderFlowGenerator::kMaxMessageCount) {
+            throw std::invalid_argument("message_count must be at most " +
+                                        std::to_string(OrderFlowGenerator::kMaxMessageCount) + ".");
+        }
+        std::string output = argv[2];
+        OrderFlowConfig config;
+        if (argc > 3) config.seed = std::stoull(argv[3]);
+        if (argc > 4) config.cancel_weight = std::stod(argv[4]);
+        if (argc > 5) config.book_depth = std::stoull(argv[5]);
+        if (argc > 6) config.burstiness = std::stod(argv[6]);
+        OrderFlowGenerator generator(config);
+
+        auto start_time = std::chrono::steady_clock::now();
+        if (output == "replay") {
+            BasicOrderBook<TradeCounter> book;
+            std::array<OrderMessage, 1024> messages;
+            std::array<MessageResult, 1024> results;
+            for (uint64_t left = message_count; left > 0;) {
+                size_t count = std::min<uint64_t>(left, messages.size());
+                generator.Next({messages.data(), count});
+                book.Apply({messages.data(), count}, {results.data(), count});
+                left -= count;
+            }
+            std::cout << "Trades: " << book.GetEventSink().TradeCount() << ", resting bid quantity "
+                      << book.GetBidQuantity() << ", ask quantity " << book.GetAskQuantity() << std::endl;
+        } else if (output.ends_with(".bin")) {
+            BinaryMessageWriter writer(output);
+            for (uint64_t i = 0; i < message_count; i++) writer.Write(generator.Next());
+            writer.Close();
+        } else {
+            CsvMessageWriter writer(output);
+            for (uint64_t i = 0; i < message_count; i++) writer.Write(generator.Next());
+            writer.Close();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+        std::cout << "Generated " << message_count << " order messages to " << output << " in " << elapsed.count()
+                  << " s, " << message_count / elapsed.count() / 1e6 << " M messages/s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
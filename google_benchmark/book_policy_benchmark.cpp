@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "book_policy.hpp"
+#include "csv_message_reader.hpp"
+#include "order.hpp"
+#include "order_book.hpp"
+
+/*  This Google Benchmark file compares the data structure policies of the OrderBook on the same workloads. Every
+ *  workload is a template over the book type and is instantiated for each configuration side by side.
+ */
+
+using DefaultBook = BasicOrderBook<NullEventSink, DefaultBookPolicy>;
+using MapBook = BasicOrderBook<NullEventSink, MapBookPolicy>;
+using VectorQueueBook = BasicOrderBook<NullEventSink, VectorQueueBookPolicy>;
+using MapVectorQueueBook =
+    BasicOrderBook<NullEventSink, BookPolicy<MapPriceLevels, VectorOrderQueue, HashOrderIdIndex>>;
+
+/*
+ *  Benchmark the replay of the example dataset through Apply, in packets of 128 messages. The dataset is loaded once,
+ *  outside of the timed loop.
+ */
+template <typename Book>
+static void BM_Policy_ReplayDataset(benchmark::State &state) {
+    std::vector<OrderMessage> messages;
+    CsvMessageReader reader("../../example_order_dataset/example_dataset.csv");
+    for (OrderMessage message; reader.Next(message);) {
+        messages.push_back(message);
+    }
+    std::vector<MessageResult> results(messages.size());
+
+    for (auto _ : state) {
+        Book order_book;
+        for (size_t first = 0; first < messages.size(); first += 128) {
+            size_t count = std::min<size_t>(128, messages.size() - first);
+            order_book.Apply({messages.data() + first, count}, {results.data() + first, count});
+        }
+        benchmark::DoNotOptimize(results);
+    }
+    state.SetItemsProcessed(state.iterations() * messages.size());
+}
+
+/*
+ *  Benchmark Add + Cancel:
+ *  Measure adding one order at a random price in a range of 20 and cancelling a random resting order, with N orders in
+ *  the book.
+ */
+template <typename Book>
+static void BM_Policy_Add1_Cancel1(benchmark::State &state) {
+    Book order_book;
+    std::vector<uint32_t> order_ids(state.range(0));
+
+    std::mt19937 gen(42);                                                         // fixed seed, same flow for all
+    std::uniform_int_distribution<> uniform_int_distribution_price(100, 119);     // price range : 20
+    std::uniform_int_distribution<> uniform_int_distribution_quantity(50, 5000);  // define quantity range
+    std::uniform_int_distribution<> random_id_index(0, order_ids.size() - 1);     // define the range
+
+    uint32_t order_id = 0;
+    auto add = [&]() {
+        OrderType side = order_id % 2 == 0 ? OrderType::BUY : OrderType::SELL;
+        uint32_t price = static_cast<uint32_t>(uniform_int_distribution_price(gen));
+        price += side == OrderType::SELL ? 20 : 0;  // asks above the bids, nothing trades
+        order_book.AddOrder({side, ++order_id, price, static_cast<uint32_t>(uniform_int_distribution_quantity(gen))});
+        return order_id;
+    };
+    for (uint32_t &id : order_ids) {
+        id = add();
+    }
+
+    for (auto _ : state) {
+        uint32_t &cancelled_id = order_ids[random_id_index(gen)];
+        order_book.CancelOrderbyId(cancelled_id);
+        cancelled_id = add();
+        benchmark::DoNotOptimize(order_book);
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+/*
+ *  Benchmark Get Ask Volume Between Prices over 10 of 20 price levels, with N orders in the book.
+ */
+template <typename Book>
+static void BM_Policy_GetAskVolumeBetweenPrices(benchmark::State &state) {
+    Book order_book;
+
+    std::mt19937 gen(42);                                                         // fixed seed, same flow for all
+    std::uniform_int_distribution<> uniform_int_distribution_price(100, 119);     // price range : 20
+    std::uniform_int_distribution<> uniform_int_distribution_quantity(50, 5000);  // define quantity range
+
+    for (uint32_t id = 1; id <= state.range(0); id++) {
+        order_book.AddOrder({OrderType::SELL, id, static_cast<uint32_t>(uniform_int_distribution_price(gen)),
+                             static_cast<uint32_t>(uniform_int_distribution_quantity(gen))});
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(order_book.GetVolumeBetweenPrices(105, 114));
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+// Dataset Replay Benchmarks
+BENCHMARK_TEMPLATE(BM_Policy_ReplayDataset, DefaultBook);
+BENCHMARK_TEMPLATE(BM_Policy_ReplayDataset, MapBook);
+BENCHMARK_TEMPLATE(BM_Policy_ReplayDataset, VectorQueueBook);
+BENCHMARK_TEMPLATE(BM_Policy_ReplayDataset, MapVectorQueueBook);
+
+// Add and Cancel Benchmarks
+BENCHMARK_TEMPLATE(BM_Policy_Add1_Cancel1, DefaultBook)->RangeMultiplier(8)->Range(1 << 10, 1 << 19)->Complexity();
+BENCHMARK_TEMPLATE(BM_Policy_Add1_Cancel1, MapBook)->RangeMultiplier(8)->Range(1 << 10, 1 << 19)->Complexity();
+BENCHMARK_TEMPLATE(BM_Policy_Add1_Cancel1, VectorQueueBook)->RangeMultiplier(8)->Range(1 << 10, 1 << 19)->Complexity();
+BENCHMARK_TEMPLATE(BM_Policy_Add1_Cancel1, MapVectorQueueBook)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 19)
+    ->Complexity();
+
+// Get Ask Volume between Prices Benchmarks
+BENCHMARK_TEMPLATE(BM_Policy_GetAskVolumeBetweenPrices, DefaultBook)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Policy_GetAskVolumeBetweenPrices, MapBook)->Arg(1 << 16);
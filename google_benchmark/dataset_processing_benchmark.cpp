@@ -1,14 +1,17 @@
 #include <benchmark/benchmark.h>
 
-#include <fstream>
+#include <algorithm>
 #include <iostream>
-#include <sstream>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "binary_order_messages.hpp"
+#include "csv_message_reader.hpp"
+#include "dataset_process.hpp"
 #include "order.hpp"
 #include "order_book.hpp"
-#include "order_utilities.hpp"
 
 /*  This Google Benchmark file is for measuring the simulated dataset processing
  * run time. */
@@ -19,58 +22,13 @@
  */
 std::vector<OrderMessage> LoadOrdersFromCSV(const std::string& filename) {
     std::vector<OrderMessage> order_messages;
-    std::ifstream file(filename);
-
-    if (file.is_open()) {
-        std::string line;
-        std::getline(file, line);  // skip the header
-
-        while (std::getline(file, line)) {
-            std::string word;
-            std::stringstream ss(line);
-            OrderMessage next_order_msg;
-            std::string order_message_type_str;
-
-            std::getline(ss, order_message_type_str, ',');
-            if (order_message_type_str == "CancelOrder") {
-                // For cancel order we fill the Order msg type and order id,
-                // other fields will not be used.
-                next_order_msg.order_message_type = OrderMessageType::CANCEL_ORDER;
-
-                std::getline(ss, word, ',');
-                next_order_msg.order.orderId = std::stoi(word);
-            } else if (order_message_type_str == "AddOrder") {
-                next_order_msg.order_message_type = OrderMessageType::ADD_ORDER;
-
-                // Fill out the Order part of the Order Message struct.
-                std::getline(ss, word, ',');
-                next_order_msg.order.orderId = std::stoi(word);
-
-                std::getline(ss, word, ',');
-                next_order_msg.order.order_type = StringToOrderType(word);
-
-                std::getline(ss, word, ',');
-                next_order_msg.order.price = std::stoi(word);
-
-                std::getline(ss, word, ',');
-                next_order_msg.order.quantity = std::stoi(word);
-            } else if (order_message_type_str == "GetBestBid") {
-                next_order_msg.order_message_type = OrderMessageType::GET_BEST_BID;
-            } else if (order_message_type_str == "GetAskVolumeBetweenPrices") {
-                next_order_msg.order_message_type = OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES;
-
-                do {
-                    std::getline(ss, word, ',');  // skip empty lines, todo: not ideal
-                } while (word.empty());
-                next_order_msg.lower_price = std::stoi(word);
-                std::getline(ss, word, ',');
-                next_order_msg.upper_price = std::stoi(word);
-            }
-
+    try {
+        CsvMessageReader reader(filename);
+        OrderMessage next_order_msg;
+        while (reader.Next(next_order_msg)) {
             order_messages.push_back(next_order_msg);
         }
-        file.close();
-    } else {
+    } catch (const std::runtime_error&) {
         std::cout << "Example Dataset File open failed " << filename << std::endl;
     }
 
@@ -93,6 +51,9 @@ static void BM_LoadAndExecuteMessages_SingleThread(benchmark::State& state) {
                 order_book.CancelOrderbyId(next_order_msg.order.orderId);
             } else if (next_order_msg.order_message_type == OrderMessageType::ADD_ORDER) {
                 order_book.AddOrder(next_order_msg.order);
+            } else if (next_order_msg.order_message_type == OrderMessageType::MODIFY_ORDER) {
+                order_book.ModifyOrder(next_order_msg.order.orderId, next_order_msg.order.price,
+                                       next_order_msg.order.quantity);
             }
             // Make sure compiler does not optimize out these unused values by
             // volatile flag
@@ -106,4 +67,60 @@ static void BM_LoadAndExecuteMessages_SingleThread(benchmark::State& state) {
     }
 }
 
-BENCHMARK(BM_LoadAndExecuteMessages_SingleThread);
\ No newline at end of file
+/*
+ *  Benchmark replay of the same dataset from the binary message format: the file is mmapped and the records are
+ *  handed to the book without parsing. The conversion from .csv happens once, outside of the timed loop.
+ */
+static void BM_ReplayBinaryMessages_SingleThread(benchmark::State& state) {
+    const std::string binary_filename = "example_dataset.bin";
+    {
+        BinaryMessageWriter writer(binary_filename);
+        for (const OrderMessage& order_message : LoadOrdersFromCSV("../../example_order_dataset/example_dataset.csv")) {
+            writer.Write(order_message);
+        }
+    }
+
+    for (auto _ : state) {
+        ReplaySession session;
+        BinaryMessageReader reader(binary_filename);
+        for (const BinaryOrderMessage& record : reader.Records()) {
+            session.ExecuteOrderMessage(ToOrderMessage(record));
+        }
+        benchmark::DoNotOptimize(session.Summary());
+    }
+}
+
+/*
+ *  Benchmark the binary replay with packets of state.range(0) messages applied through OrderBook::Apply.
+ */
+static void BM_ReplayBinaryMessages_Batched(benchmark::State& state) {
+    const std::string binary_filename = "example_dataset.bin";
+    {
+        BinaryMessageWriter writer(binary_filename);
+        for (const OrderMessage& order_message : LoadOrdersFromCSV("../../example_order_dataset/example_dataset.csv")) {
+            writer.Write(order_message);
+        }
+    }
+    const size_t packet_size = state.range(0);
+    std::vector<OrderMessage> packet(packet_size);
+    std::vector<MessageResult> results(packet_size);
+
+    for (auto _ : state) {
+        OrderBook order_book;
+        benchmark::DoNotOptimize(order_book);
+        BinaryMessageReader reader(binary_filename);
+        std::span<const BinaryOrderMessage> records = reader.Records();
+        for (size_t first = 0; first < records.size(); first += packet_size) {
+            size_t count = std::min(packet_size, records.size() - first);
+            for (size_t i = 0; i < count; i++) {
+                packet[i] = ToOrderMessage(records[first + i]);
+            }
+            order_book.Apply({packet.data(), count}, results);
+        }
+        benchmark::DoNotOptimize(results);
+    }
+}
+
+BENCHMARK(BM_LoadAndExecuteMessages_SingleThread);
+BENCHMARK(BM_ReplayBinaryMessages_SingleThread);
+BENCHMARK(BM_ReplayBinaryMessages_Batched)->Arg(20)->Arg(200);
\ No newline at end of file
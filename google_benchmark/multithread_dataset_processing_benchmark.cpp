@@ -1,20 +1,121 @@
 #include <benchmark/benchmark.h>
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <thread>
+#include <vector>
 
+#include "backtest_runner.hpp"
 #include "dataset_process.hpp"
+#include "ingest_sequencer.hpp"
+#include "spsc_channel.hpp"
 
 static void BM_LoadAndExecuteMessages_MultiThread(benchmark::State& state) {
-    filename = "../../example_order_dataset/example_dataset.csv";
+    for (auto _ : state) {
+        ReplaySession session;
+        session.ReplayCsv("../../example_order_dataset/example_dataset.csv");
+    }
+}
+
+/*
+ *  Hand-off cost of the channel alone: 1M order messages pushed by one thread and popped by another, in batches of
+ *  state.range(0) messages, for each wait strategy.
+ */
+template <typename WaitStrategy>
+static void BM_SpscChannelHandOff(benchmark::State& state) {
+    constexpr uint32_t kMessages = 1 << 20;
+    const size_t batch_size = state.range(0);
 
     for (auto _ : state) {
-        read_in_is_done = false;  // flag for consumer_thread to keep running
-        std::thread producer_thread{LoadOrdersFromCSV};
-        std::thread consumer_thread{ProcessOrderMessages};
+        SpscChannel<OrderMessage, WaitStrategy> channel(kOrderMessageChannelCapacity);
+        std::thread producer_thread{[&channel, batch_size] {
+            std::array<OrderMessage, 256> batch{};
+            for (uint32_t sent = 0; sent < kMessages; sent += batch_size) {
+                batch[0].order.orderId = sent;
+                channel.Push({batch.data(), batch_size});
+            }
+            channel.Close();
+        }};
+        std::array<OrderMessage, 256> batch;
+        uint64_t received = 0;
+        while (size_t count = channel.Pop({batch.data(), batch_size})) {
+            received += count;
+        }
         producer_thread.join();
-        consumer_thread.join();
+        benchmark::DoNotOptimize(received);
+    }
+    state.SetItemsProcessed(state.iterations() * kMessages);
+}
+
+/*
+ *  Merge cost of the ingest sequencer: 1M order messages published by state.range(0) session threads in blocks of 64,
+ *  merged into one sequenced stream by the calling thread.
+ */
+static void BM_IngestSequencer(benchmark::State& state) {
+    constexpr uint64_t kMessages = 1 << 20;
+    constexpr size_t kBlockSize = 64;
+    const size_t session_count = state.range(0);
+
+    for (auto _ : state) {
+        IngestSequencer<> sequencer(session_count, kOrderMessageChannelCapacity);
+        std::vector<std::thread> sessions;
+        for (size_t session = 0; session < session_count; session++) {
+            sessions.emplace_back([&sequencer, session, session_count] {
+                std::array<IngestMessage, kBlockSize> block{};
+                for (uint64_t first = session * kBlockSize; first < kMessages; first += session_count * kBlockSize) {
+                    for (size_t i = 0; i < kBlockSize; i++) {
+                        block[i].timestamp = first + i;
+                    }
+                    sequencer.Publish(session, block);
+                }
+                sequencer.Close(session);
+            });
+        }
+        std::array<SequencedMessage, 256> out;
+        uint64_t received = 0;
+        while (!sequencer.Done()) {
+            size_t count = sequencer.Poll(out);
+            if (count == 0) std::this_thread::yield();
+            received += count;
+        }
+        for (std::thread& session : sessions) session.join();
+        benchmark::DoNotOptimize(received);
+    }
+    state.SetItemsProcessed(state.iterations() * kMessages);
+}
+
+/*
+ *  The example dataset fed by state.range(0) concurrent sessions, merged back in file order and matched.
+ */
+static void BM_LoadAndExecuteMessages_Sessions(benchmark::State& state) {
+    for (auto _ : state) {
+        ReplaySession session;
+        session.ReplayFromSessions("../../example_order_dataset/example_dataset.csv", state.range(0));
+    }
+}
+
+/*
+ *  Backtest throughput: 32 generated flows of 100k messages, one per seed, replayed by a pool of state.range(0)
+ *  threads, each run on its own session.
+ */
+static void BM_BacktestRunner(benchmark::State& state) {
+    constexpr uint64_t kRuns = 32;
+    constexpr uint64_t kMessagesPerRun = 100'000;
+    std::vector<ReplayJob> jobs;
+    for (uint64_t seed = 1; seed <= kRuns; seed++) {
+        jobs.push_back({{}, OrderFlowConfig{.seed = seed}, kMessagesPerRun});
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(RunReplays(jobs, state.range(0)));
     }
+    state.SetItemsProcessed(state.iterations() * kRuns * kMessagesPerRun);
 }
 
 BENCHMARK(BM_LoadAndExecuteMessages_MultiThread);
+BENCHMARK(BM_LoadAndExecuteMessages_Sessions)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+BENCHMARK(BM_BacktestRunner)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+BENCHMARK(BM_IngestSequencer)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+BENCHMARK(BM_SpscChannelHandOff<BusySpinWait>)->Arg(1)->Arg(64)->UseRealTime();
+BENCHMARK(BM_SpscChannelHandOff<SpinThenYieldWait>)->Arg(1)->Arg(64)->UseRealTime();
+BENCHMARK(BM_SpscChannelHandOff<FutexWait>)->Arg(1)->Arg(64)->UseRealTime();
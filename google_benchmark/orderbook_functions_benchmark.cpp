@@ -1,7 +1,24 @@
 #include <benchmark/benchmark.h>
 
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
 #include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "depth_snapshot.hpp"
+#include "journal.hpp"
 #include "order.hpp"
 #include "order_book.hpp"
 
@@ -122,6 +139,81 @@ static void BM_Add1_Cancel1_Random_Order(benchmark::State &state) {
     state.SetComplexityN(state.range(0));
 }
 
+/*
+ *  Benchmark order amends:
+ *  Measure one quote amend of a random resting order among N, alternately a size reduction at the same price and a
+ *  new price, either with ModifyOrder or as CancelOrderbyId + AddOrder of a new order id.
+ */
+template <bool kModify>
+static void BM_Amend_Random_Order(benchmark::State &state) {
+    OrderBook order_book;
+    std::vector<Order> orders(state.range(0));  // the resting orders, as last amended
+
+    std::mt19937 gen(42);                                                      // fixed seed, same flow for both
+    std::uniform_int_distribution<> uniform_int_distribution_price(100, 119);  // price range : 20
+    std::uniform_int_distribution<> random_id_index(0, orders.size() - 1);     // define the range
+
+    uint32_t order_id = 0;
+    for (Order &order : orders) {
+        order = {OrderType::BUY, ++order_id, static_cast<uint32_t>(uniform_int_distribution_price(gen)), 5000};
+        order_book.AddOrder(order);
+    }
+
+    bool reprice = false;
+    for (auto _ : state) {
+        Order &order = orders[random_id_index(gen)];
+        reprice = !reprice;
+        if (reprice) {
+            order.price = static_cast<uint32_t>(uniform_int_distribution_price(gen));
+        } else {
+            order.quantity = order.quantity > 1 ? order.quantity - 1 : 5000;
+        }
+        if constexpr (kModify) {
+            order_book.ModifyOrder(order.orderId, order.price, order.quantity);
+        } else {
+            order_book.CancelOrderbyId(order.orderId);
+            order.orderId = ++order_id;
+            order_book.AddOrder(order);
+        }
+        benchmark::DoNotOptimize(order_book);
+    }
+
+    state.SetComplexityN(state.range(0));
+}
+
+/*
+ *  Benchmark taker orders:
+ *  Measure an aggressive buy that takes up to 150 units from the best asks and is not left in the book, with N asks
+ *  preloaded and one ask added per iteration. As an IOC order, or as the same limit order cancelled right after.
+ */
+template <bool kImmediateOrCancel>
+static void BM_Taker_Order(benchmark::State &state) {
+    OrderBook order_book;
+
+    std::mt19937 gen(42);                                                      // fixed seed, same flow for both
+    std::uniform_int_distribution<> uniform_int_distribution_price(100, 119);  // price range : 20
+
+    uint32_t order_id = 0;
+    for (int i = 0; i < state.range(0); i++) {
+        order_book.AddOrder(
+            {OrderType::SELL, ++order_id, static_cast<uint32_t>(uniform_int_distribution_price(gen)), 100});
+    }
+
+    for (auto _ : state) {
+        order_book.AddOrder(
+            {OrderType::SELL, ++order_id, static_cast<uint32_t>(uniform_int_distribution_price(gen)), 100});
+        if constexpr (kImmediateOrCancel) {
+            order_book.AddOrder({OrderType::BUY, ++order_id, 119, 150, OrderKind::IOC});
+        } else {
+            order_book.AddOrder({OrderType::BUY, ++order_id, 119, 150});
+            order_book.CancelOrderbyId(order_id);
+        }
+        benchmark::DoNotOptimize(order_book);
+    }
+
+    state.SetComplexityN(state.range(0));
+}
+
 /*
  * In this benchmark we only cancel 1 order but do not add another one, 1000 times inside the benchmark loop.
  * This likely results in much better results for N close to 1000, as we cancel big % of all orders from the hashmap.
@@ -267,6 +359,325 @@ static void BM_GetAskVolumeBetweenPrices(benchmark::State &state) {
     state.SetComplexityN(state.range(0));
 }
 
+/*
+ *  Benchmark Get Depth:
+ *  Measure Asymptotic Complexity of copying the 10 best bid levels, while having N orders over 1000 prices in the
+ *  Orderbook.
+ */
+static void BM_GetDepth_Top10(benchmark::State &state) {
+    OrderBook order_book;
+
+    std::random_device rd;                                                        // random seed
+    std::mt19937 gen(rd());                                                       // mersenne Twister engine
+    std::uniform_int_distribution<> uniform_int_distribution_price(1, 1000);      // price range: 1000
+    std::uniform_int_distribution<> uniform_int_distribution_quantity(50, 5000);  // define quantity range
+
+    Order buy_order = {OrderType::BUY, 1, 100, 5};
+
+    // preload varied amount of orders, based on benchmark state input
+    for (int i = 0; i < state.range(0); i++) {
+        buy_order.orderId = i + 1;
+        buy_order.price = uniform_int_distribution_price(gen);
+        buy_order.quantity = uniform_int_distribution_quantity(gen);
+        order_book.AddOrder(buy_order);
+    }
+
+    std::array<DepthLevel, 10> depth;
+    for (auto _ : state) {
+        // Benchmark loop
+        benchmark::DoNotOptimize(order_book.GetDepth(OrderType::BUY, depth));
+        benchmark::DoNotOptimize(depth);
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+/*
+ *  Benchmark Snapshot Restore:
+ *  Measure LoadSnapshot of a book with N resting orders over 1000 prices per side, into a new book. The snapshot is
+ *  written once, outside of the timed loop.
+ */
+static void BM_LoadSnapshot(benchmark::State &state) {
+    const std::string path = "order_book_snapshot.bin";
+    {
+        OrderBook order_book(1);  // the events are not needed
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<> uniform_int_distribution_price(1, 1000);      // price range: 1000
+        std::uniform_int_distribution<> uniform_int_distribution_quantity(50, 5000);  // define quantity range
+        order_book.Reserve(state.range(0));
+        for (uint32_t id = 1; id <= state.range(0); id++) {
+            OrderType side = id % 2 == 0 ? OrderType::BUY : OrderType::SELL;
+            uint32_t price = uniform_int_distribution_price(gen) + (side == OrderType::SELL ? 1000 : 0);
+            order_book.AddOrder({side, id, price, static_cast<uint32_t>(uniform_int_distribution_quantity(gen))});
+        }
+        order_book.SaveSnapshot(path);
+    }
+
+    for (auto _ : state) {
+        auto order_book = std::make_unique<OrderBook>(1);
+        order_book->LoadSnapshot(path);
+        benchmark::DoNotOptimize(order_book->GetBestBid());
+        state.PauseTiming();  // exclude the destruction of the book
+        order_book.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/*
+ *  Benchmark the journal cost on the matching thread:
+ *  Measure adding one order and cancelling a random resting order through ApplyJournaled, with N orders in the book.
+ *  With the journal the messages are copied to the writer thread, which writes and syncs them in groups. Without it
+ *  the same path runs with no journal attached.
+ */
+template <bool kJournal>
+static void BM_Journaled_Add1_Cancel1(benchmark::State &state) {
+    const std::string path = "order_book_journal.bin";
+    std::remove(path.c_str());
+    auto journal = kJournal ? std::make_unique<JournalWriter>(path) : nullptr;
+    BasicOrderBook<JournalSink<>> order_book(journal.get());
+    std::vector<uint32_t> order_ids(state.range(0));
+
+    std::mt19937 gen(42);                                                         // fixed seed, same flow for both
+    std::uniform_int_distribution<> uniform_int_distribution_price(100, 119);     // price range : 20
+    std::uniform_int_distribution<> uniform_int_distribution_quantity(50, 5000);  // define quantity range
+    std::uniform_int_distribution<> random_id_index(0, order_ids.size() - 1);
+
+    uint64_t sequence = 0;
+    uint32_t order_id = 0;
+    std::array<OrderMessage, 2> messages;
+    std::array<MessageResult, 2> results;
+    auto add = [&](OrderMessage &message) {
+        OrderType side = order_id % 2 == 0 ? OrderType::BUY : OrderType::SELL;
+        uint32_t price = static_cast<uint32_t>(uniform_int_distribution_price(gen));
+        price += side == OrderType::SELL ? 20 : 0;  // asks above the bids, nothing trades
+        message = {OrderMessageType::ADD_ORDER,
+                   {side, ++order_id, price, static_cast<uint32_t>(uniform_int_distribution_quantity(gen))}};
+        return order_id;
+    };
+    for (uint32_t &id : order_ids) {
+        id = add(messages[0]);
+        sequence += ApplyJournaled(order_book, sequence, {messages.data(), 1}, {results.data(), 1});
+    }
+
+    for (auto _ : state) {
+        uint32_t &cancelled_id = order_ids[random_id_index(gen)];
+        messages[0] = {OrderMessageType::CANCEL_ORDER, {OrderType::UNDEFINED, cancelled_id}};
+        cancelled_id = add(messages[1]);
+        sequence += ApplyJournaled(order_book, sequence, messages, results);
+        benchmark::DoNotOptimize(results);
+    }
+    if (journal) {
+        journal->Close();
+        std::remove(path.c_str());
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+
+/*
+ * Resident memory of the process in bytes, 0 where /proc/self/statm is not available.
+ */
+static uint64_t ResidentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t total_pages = 0;
+    uint64_t resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) return 0;
+#ifdef __linux__
+    return resident_pages * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Last level cache misses of the calling thread, user space only, counted by the PMU through perf_event_open. Valid()
+ * is false where the counter is not available (not Linux, no PMU in a VM, perf_event_paranoid), the benchmarks then
+ * just leave the counter out.
+ */
+class CacheMissCounter {
+   public:
+    CacheMissCounter() {
+#ifdef __linux__
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+    }
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd_ >= 0) close(fd_);
+#endif
+    }
+    CacheMissCounter(const CacheMissCounter &) = delete;
+    CacheMissCounter &operator=(const CacheMissCounter &) = delete;
+
+    bool Valid() const { return fd_ >= 0; }
+
+    uint64_t Read() const {
+        uint64_t count = 0;
+#ifdef __linux__
+        if (fd_ < 0 || read(fd_, &count, sizeof(count)) != sizeof(count)) return 0;
+#endif
+        return count;
+    }
+
+   private:
+    int fd_{-1};
+};
+
+/*
+ *  Benchmark fills against a deep book:
+ *  Measure an IOC buy filling exactly the oldest ask at the best price, with N asks resting over P prices and one
+ *  ask added per iteration. Over 1000 prices the orders of a level are a thousand nodes apart in the pool, over 4
+ *  they are neighbours. With millions of resting orders the book does not fit in the caches and the fills read
+ *  nodes from memory. Reports the resident memory per resting order (pool, id index and levels) and, where the PMU
+ *  is available, the cache misses per fill.
+ */
+static void BM_Fill_Deep_Book(benchmark::State &state) {
+    const uint32_t order_count = state.range(0);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> uniform_int_distribution_price(1000, 1000 + state.range(1) - 1);
+
+    uint64_t resident_before = ResidentBytes();
+    auto order_book = std::make_unique<OrderBook>(1);  // the events are not needed
+    order_book->Reserve(order_count);
+    uint32_t order_id = 0;
+    auto add_ask = [&] {
+        uint32_t price = uniform_int_distribution_price(gen);
+        order_book->AddOrder({OrderType::SELL, ++order_id, price, 100});
+    };
+    for (uint32_t i = 0; i < order_count; i++) {
+        add_ask();
+    }
+    uint64_t resident_after = ResidentBytes();
+
+    CacheMissCounter cache_misses;
+    uint64_t misses_before = cache_misses.Read();
+    for (auto _ : state) {
+        add_ask();
+        order_book->AddOrder({OrderType::BUY, ++order_id, 2000, 100, OrderKind::IOC});
+    }
+    uint64_t misses = cache_misses.Read() - misses_before;
+
+    state.SetItemsProcessed(state.iterations());
+    if (resident_after > resident_before) {
+        state.counters["bytes_per_order"] = static_cast<double>(resident_after - resident_before) / order_count;
+    }
+    if (cache_misses.Valid()) {
+        state.counters["misses_per_fill"] = static_cast<double>(misses) / state.iterations();
+    }
+}
+
+/*
+ *  Benchmark polling the top of book from another thread:
+ *  Measure TopOfBookCell::Read on the calling thread. With state.range(0) a writer thread keeps adding and cancelling
+ *  orders at the best bid meanwhile, so most reads race a publish.
+ */
+static void BM_TopOfBook_Read(benchmark::State &state) {
+    auto order_book = std::make_unique<OrderBook>(1);  // the events are not needed
+    order_book->AddOrder({OrderType::SELL, 1, 200, 100});
+    std::atomic<bool> done{false};
+    std::thread writer;
+    if (state.range(0)) {
+        writer = std::thread([&] {
+            for (uint32_t order_id = 2; !done.load(std::memory_order_relaxed); order_id++) {
+                order_book->AddOrder({OrderType::BUY, order_id, 100 + order_id % 2, 10});
+                order_book->CancelOrderbyId(order_id);
+            }
+        });
+    }
+    const TopOfBookCell &top_of_book = order_book->GetTopOfBook();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(top_of_book.Read());
+    }
+    done = true;
+    if (writer.joinable()) writer.join();
+}
+
+/*
+ *  Benchmark the depth snapshots:
+ *  Measure the matching thread publishing a depth image of a book with N levels per side, and a reader running a
+ *  range query on the published image.
+ */
+static void BM_DepthSnapshot_Publish(benchmark::State &state) {
+    auto order_book = std::make_unique<OrderBook>(1);  // the events are not needed
+    uint32_t order_id = 0;
+    for (uint32_t level = 0; level < state.range(0); level++) {
+        order_book->AddOrder({OrderType::BUY, ++order_id, 10000 - level, 100});
+        order_book->AddOrder({OrderType::SELL, ++order_id, 10001 + level, 100});
+    }
+    DepthSnapshotPublisher publisher;
+    for (auto _ : state) {
+        publisher.Publish(*order_book, order_book->GetMessageSequence());
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+static void BM_DepthSnapshot_VolumeBetween(benchmark::State &state) {
+    auto order_book = std::make_unique<OrderBook>(1);
+    uint32_t order_id = 0;
+    for (uint32_t level = 0; level < state.range(0); level++) {
+        order_book->AddOrder({OrderType::SELL, ++order_id, 10001 + level, 100});
+    }
+    DepthSnapshotPublisher publisher;
+    publisher.Publish(*order_book, order_book->GetMessageSequence());
+    DepthSnapshot snapshot = publisher.Acquire();
+    uint32_t low = 10001;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(snapshot->VolumeBetween(OrderType::SELL, low, low + state.range(0) / 2));
+        low = low < 10001 + state.range(0) / 2 ? low + 1 : 10001;
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+/*
+ *  Benchmark a market maker pulling its quotes:
+ *  Measure cancelling the N resting orders of one owner, spread over 20 price levels per side among the orders of
+ *  other owners, one CancelOrderbyId per order, with CancelOwnerOrders, and with CancelSide for both sides (every
+ *  owner, whole levels at once).
+ */
+enum class MassCancelMethod { BY_ID, BY_OWNER, BY_SIDE };
+
+template <MassCancelMethod kMethod>
+static void BM_MassCancel(benchmark::State &state) {
+    const uint32_t order_count = state.range(0);
+    auto order_book = std::make_unique<OrderBook>(1 << 20);  // no events dropped within a burst
+    order_book->Reserve(2 * order_count);
+    uint32_t order_id = 0;
+    std::vector<uint32_t> quote_ids(order_count);
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (uint32_t i = 0; i < order_count; i++) {
+            uint32_t level = i % 20;
+            OrderType side = i % 2 == 0 ? OrderType::BUY : OrderType::SELL;
+            uint32_t price = side == OrderType::BUY ? 100 - level : 101 + level;
+            order_book->AddOrder({side, ++order_id, price, 10, OrderKind::LIMIT, 2});  // another owner
+            quote_ids[i] = ++order_id;
+            order_book->AddOrder({side, order_id, price, 10, OrderKind::LIMIT, 1});
+        }
+        order_book->GetEventSink().Drain([](const BookEvent &) {});
+        state.ResumeTiming();
+        if constexpr (kMethod == MassCancelMethod::BY_ID) {
+            for (uint32_t id : quote_ids) order_book->CancelOrderbyId(id);
+        } else if constexpr (kMethod == MassCancelMethod::BY_OWNER) {
+            order_book->CancelOwnerOrders(1);
+        } else {
+            order_book->CancelSide(OrderType::BUY);
+            order_book->CancelSide(OrderType::SELL);
+        }
+        state.PauseTiming();
+        order_book->CancelSide(OrderType::BUY);
+        order_book->CancelSide(OrderType::SELL);
+        order_book->GetEventSink().Drain([](const BookEvent &) {});
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * order_count);
+}
+
 // Add Order Benchmarks
 BENCHMARK(BM_AddOrder_PriceRange_3)->RangeMultiplier(2)->Range(1 << 10, 1 << 20)->Complexity();
 BENCHMARK(BM_AddOrder_PriceRange_20)->RangeMultiplier(2)->Range(1 << 10, 1 << 20)->Complexity();
@@ -277,12 +688,45 @@ BENCHMARK(BM_Add1_Cancel1_Random_Order)->RangeMultiplier(2)->Range(1 << 10, 1 <<
 BENCHMARK(BM_Add1_Cancel1_Random_Order_Sell)->RangeMultiplier(2)->Range(1 << 10, 1 << 20)->Complexity();
 BENCHMARK(BM_Cancel1_Random_Order)->RangeMultiplier(2)->Range(1 << 10, 1 << 20)->Iterations(1000)->Complexity();
 
+// Amend Order Benchmarks
+BENCHMARK_TEMPLATE(BM_Amend_Random_Order, true)->RangeMultiplier(4)->Range(1 << 10, 1 << 20)->Complexity();
+BENCHMARK_TEMPLATE(BM_Amend_Random_Order, false)->RangeMultiplier(4)->Range(1 << 10, 1 << 20)->Complexity();
+
+// Taker Order Benchmarks
+BENCHMARK_TEMPLATE(BM_Taker_Order, true)->RangeMultiplier(4)->Range(1 << 10, 1 << 20)->Complexity();
+BENCHMARK_TEMPLATE(BM_Taker_Order, false)->RangeMultiplier(4)->Range(1 << 10, 1 << 20)->Complexity();
+
 // Get Best Bid Benchmarks
 BENCHMARK(BM_GetBestBid)->RangeMultiplier(2)->Range(1 << 10, 1 << 20)->Complexity();
 
 // Get Ask Volume between Prices Benchmarks
 BENCHMARK(BM_GetAskVolumeBetweenPrices)->RangeMultiplier(2)->Range(1 << 10, 1 << 20)->Complexity();
 
+// Snapshot Benchmarks
+BENCHMARK(BM_LoadSnapshot)->RangeMultiplier(8)->Range(1 << 16, 1 << 22)->Unit(benchmark::kMillisecond);
+
+// Journal Benchmarks
+BENCHMARK_TEMPLATE(BM_Journaled_Add1_Cancel1, true)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Journaled_Add1_Cancel1, false)->Arg(1 << 16);
+
+// Mass Cancel Benchmarks
+BENCHMARK_TEMPLATE(BM_MassCancel, MassCancelMethod::BY_ID)->RangeMultiplier(8)->Range(1 << 6, 1 << 15);
+BENCHMARK_TEMPLATE(BM_MassCancel, MassCancelMethod::BY_OWNER)->RangeMultiplier(8)->Range(1 << 6, 1 << 15);
+BENCHMARK_TEMPLATE(BM_MassCancel, MassCancelMethod::BY_SIDE)->RangeMultiplier(8)->Range(1 << 6, 1 << 15);
+
+// Deep Book Fill Benchmarks
+BENCHMARK(BM_Fill_Deep_Book)->ArgsProduct({{1 << 15, 1 << 18, 1 << 21, 1 << 24}, {4, 1000}});
+
+// Top of Book Benchmarks
+BENCHMARK(BM_TopOfBook_Read)->Arg(0)->Arg(1);
+
+// Depth Snapshot Benchmarks
+BENCHMARK(BM_DepthSnapshot_Publish)->RangeMultiplier(8)->Range(1 << 4, 1 << 13)->Complexity();
+BENCHMARK(BM_DepthSnapshot_VolumeBetween)->RangeMultiplier(8)->Range(1 << 4, 1 << 13)->Complexity();
+
+// Get Depth Benchmarks
+BENCHMARK(BM_GetDepth_Top10)->RangeMultiplier(2)->Range(1 << 10, 1 << 20)->Complexity();
+
 
 // Init and run all BENCHMARK macro registered cases
 BENCHMARK_MAIN();
@@ -0,0 +1,323 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <numbers>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "latency_stats.hpp"
+#include "order.hpp"
+#include "order_book.hpp"
+#include "order_flow_generator.hpp"
+
+/*  This Google Benchmark file replays named order flow scenarios, shaped after production books rather than single
+ *  operations. Every scenario is generated before the benchmark loop: a setup flow that builds the book shape, not
+ *  timed, and the timed flow. The timed loop applies the timed flow in one Apply call on a fresh copy of the book and
+ *  reports messages per second. One more pass after the loop times every message and reports the per message type
+ *  percentiles (p50, p99, p99.9 in nanoseconds) as counters, with the taker orders (market, IOC, FOK) apart.
+ */
+
+using ScenarioBook = BasicOrderBook<NullEventSink>;
+
+struct Scenario {
+    std::vector<OrderMessage> setup;     // builds the book, not timed
+    std::vector<OrderMessage> messages;  // timed
+};
+
+constexpr size_t kScenarioMessages = size_t{1} << 18;
+
+/*
+ * Order flow generator: increasing order ids and the resting orders it added, for random cancels. An order that
+ * traded away may still get a cancel, rejected as unknown like in a real feed.
+ */
+class FlowBuilder {
+   public:
+    explicit FlowBuilder(uint32_t seed) : gen_(seed) {}
+
+    uint32_t Uniform(uint32_t low, uint32_t high) { return std::uniform_int_distribution<uint32_t>(low, high)(gen_); }
+    bool Chance(double probability) { return std::bernoulli_distribution(probability)(gen_); }
+
+    void Add(std::vector<OrderMessage>& flow, OrderType side, uint32_t price, uint32_t quantity,
+             OrderKind kind = OrderKind::LIMIT) {
+        flow.push_back({.order_message_type = OrderMessageType::ADD_ORDER,
+                        .order = {.order_type = side,
+                                  .orderId = ++order_id_,
+                                  .price = price,
+                                  .quantity = quantity,
+                                  .kind = kind}});
+        if (kind == OrderKind::LIMIT) {
+            resting_.push_back(order_id_);
+        }
+    }
+
+    void CancelRandom(std::vector<OrderMessage>& flow) {
+        if (resting_.empty()) {
+            return;
+        }
+        size_t index = Uniform(0, resting_.size() - 1);
+        flow.push_back({.order_message_type = OrderMessageType::CANCEL_ORDER, .order = {.orderId = resting_[index]}});
+        resting_[index] = resting_.back();
+        resting_.pop_back();
+    }
+
+    void Query(std::vector<OrderMessage>& flow) {
+        if (Chance(0.5)) {
+            flow.push_back({.order_message_type = OrderMessageType::GET_BEST_BID, .order = {}});
+        } else {
+            flow.push_back({.order_message_type = OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES,
+                            .order = {},
+                            .lower_price = 0,
+                            .upper_price = 1 << 30});
+        }
+    }
+
+   private:
+    std::mt19937 gen_;
+    uint32_t order_id_{0};
+    std::vector<uint32_t> resting_;
+};
+
+/*
+ * Deep passive book: 200k orders over 1000 levels per side. Adds anywhere in the depth (50%), cancels (45%) and
+ * queries (5%), nothing trades.
+ */
+static Scenario DeepPassiveBook() {
+    Scenario scenario;
+    FlowBuilder flow(1);
+    auto add = [&](std::vector<OrderMessage>& messages) {
+        OrderType side = flow.Chance(0.5) ? OrderType::BUY : OrderType::SELL;
+        uint32_t price = side == OrderType::BUY ? flow.Uniform(99000, 99999) : flow.Uniform(100001, 101000);
+        flow.Add(messages, side, price, flow.Uniform(1, 1000));
+    };
+    while (scenario.setup.size() < 200000) {
+        add(scenario.setup);
+    }
+    while (scenario.messages.size() < kScenarioMessages) {
+        uint32_t pick = flow.Uniform(0, 99);
+        if (pick < 50) {
+            add(scenario.messages);
+        } else if (pick < 95) {
+            flow.CancelRandom(scenario.messages);
+        } else {
+            flow.Query(scenario.messages);
+        }
+    }
+    return scenario;
+}
+
+/*
+ * Cancel heavy: 95% cancels of random resting orders and 5% adds, the book is 300k orders near the touch.
+ */
+static Scenario CancelHeavy() {
+    Scenario scenario;
+    FlowBuilder flow(2);
+    auto add = [&](std::vector<OrderMessage>& messages) {
+        OrderType side = flow.Chance(0.5) ? OrderType::BUY : OrderType::SELL;
+        uint32_t price = side == OrderType::BUY ? flow.Uniform(9980, 9999) : flow.Uniform(10001, 10020);
+        flow.Add(messages, side, price, flow.Uniform(1, 1000));
+    };
+    while (scenario.setup.size() < 300000) {
+        add(scenario.setup);
+    }
+    while (scenario.messages.size() < kScenarioMessages) {
+        if (flow.Chance(0.95)) {
+            flow.CancelRandom(scenario.messages);
+        } else {
+            add(scenario.messages);
+        }
+    }
+    return scenario;
+}
+
+/*
+ * Aggressive sweeps: 50 levels per side, refilled by passive adds. One message in ten is an IOC order that takes
+ * 5 to 15 levels' worth of quantity from the other side.
+ */
+static Scenario AggressiveSweeps() {
+    Scenario scenario;
+    FlowBuilder flow(3);
+    auto add = [&](std::vector<OrderMessage>& messages) {
+        OrderType side = flow.Chance(0.5) ? OrderType::BUY : OrderType::SELL;
+        uint32_t price = side == OrderType::BUY ? flow.Uniform(950, 999) : flow.Uniform(1001, 1050);
+        flow.Add(messages, side, price, flow.Uniform(100, 3900));
+    };
+    while (scenario.setup.size() < 50000) {
+        add(scenario.setup);
+    }
+    while (scenario.messages.size() < kScenarioMessages) {
+        if (flow.Uniform(0, 9) == 0) {
+            OrderType side = flow.Chance(0.5) ? OrderType::BUY : OrderType::SELL;
+            uint32_t limit = side == OrderType::BUY ? 1050 : 950;
+            flow.Add(scenario.messages, side, limit, flow.Uniform(5, 15) * 2000, OrderKind::IOC);
+        } else {
+            add(scenario.messages);
+        }
+    }
+    return scenario;
+}
+
+/*
+ * Wide sparse prices: orders spread over a million ticks per side, almost every add opens a level and almost every
+ * cancel closes one. Adds (50%) and cancels (50%).
+ */
+static Scenario WideSparseRange() {
+    Scenario scenario;
+    FlowBuilder flow(4);
+    auto add = [&](std::vector<OrderMessage>& messages) {
+        OrderType side = flow.Chance(0.5) ? OrderType::BUY : OrderType::SELL;
+        uint32_t price = side == OrderType::BUY ? flow.Uniform(1, 1000000) : flow.Uniform(1000001, 2000000);
+        flow.Add(messages, side, price, flow.Uniform(1, 1000));
+    };
+    while (scenario.setup.size() < 100000) {
+        add(scenario.setup);
+    }
+    while (scenario.messages.size() < kScenarioMessages) {
+        if (flow.Chance(0.5)) {
+            add(scenario.messages);
+        } else {
+            flow.CancelRandom(scenario.messages);
+        }
+    }
+    return scenario;
+}
+
+/*
+ * Oscillating prices: the mid price swings 200 ticks up and down, orders are added within 5 ticks of it and cancelled
+ * at random. The moving mid keeps creating levels ahead of it, crossing the levels it runs into and leaving levels
+ * behind. Adds (60%), cancels (40%).
+ */
+static Scenario OscillatingPrices() {
+    Scenario scenario;
+    FlowBuilder flow(5);
+    size_t step = 0;
+    auto add = [&](std::vector<OrderMessage>& messages) {
+        double phase = 2 * std::numbers::pi * static_cast<double>(step++) / 20000;
+        uint32_t mid = 10000 + static_cast<uint32_t>(std::lround(200 * std::sin(phase) + 200));
+        OrderType side = flow.Chance(0.5) ? OrderType::BUY : OrderType::SELL;
+        uint32_t price = side == OrderType::BUY ? mid - flow.Uniform(1, 5) : mid + flow.Uniform(1, 5);
+        flow.Add(messages, side, price, flow.Uniform(1, 1000));
+    };
+    while (scenario.setup.size() < 10000) {
+        add(scenario.setup);
+    }
+    while (scenario.messages.size() < kScenarioMessages) {
+        if (flow.Chance(0.6)) {
+            add(scenario.messages);
+        } else {
+            flow.CancelRandom(scenario.messages);
+        }
+    }
+    return scenario;
+}
+
+// Operations timed separately: one per message type, and the market, IOC and FOK adds apart from the limit adds.
+constexpr size_t kTakerOperation = LatencyRecorder::kMessageTypeCount;
+constexpr size_t kOperationCount = kTakerOperation + 1;
+
+static size_t OperationOf(const OrderMessage& message) {
+    if (message.order_message_type == OrderMessageType::ADD_ORDER && message.order.kind != OrderKind::LIMIT) {
+        return kTakerOperation;
+    }
+    return static_cast<size_t>(message.order_message_type);
+}
+
+static const char* CounterPrefix(size_t operation) {
+    if (operation == kTakerOperation) {
+        return "taker";
+    }
+    switch (static_cast<OrderMessageType>(operation)) {
+        case OrderMessageType::ADD_ORDER:
+            return "add";
+        case OrderMessageType::CANCEL_ORDER:
+            return "cancel";
+        case OrderMessageType::GET_BEST_BID:
+            return "best_bid";
+        case OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES:
+            return "ask_volume";
+        case OrderMessageType::MODIFY_ORDER:
+            return "modify";
+        default:
+            return "undefined";
+    }
+}
+
+/*
+ *  Benchmark a scenario: throughput of the timed flow, then its per message type latency percentiles.
+ */
+template <Scenario (*MakeScenario)()>
+static void BM_Scenario(benchmark::State &state) {
+    const Scenario scenario = MakeScenario();
+    std::vector<MessageResult> results(std::max(scenario.setup.size(), scenario.messages.size()));
+    auto make_book = [&] {
+        auto order_book = std::make_unique<ScenarioBook>();
+        order_book->Reserve(scenario.setup.size());
+        order_book->Apply(scenario.setup, results);
+        return order_book;
+    };
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto order_book = make_book();
+        state.ResumeTiming();
+        order_book->Apply(scenario.messages, results);
+        benchmark::DoNotOptimize(results);
+        state.PauseTiming();  // exclude the destruction of the book
+        order_book.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * scenario.messages.size());
+
+    auto histograms = std::make_unique<std::array<LatencyHistogram, kOperationCount>>();
+    auto order_book = make_book();
+    for (const OrderMessage &message : scenario.messages) {
+        uint64_t start = ReadTsc();
+        order_book->Apply({&message, 1}, {results.data(), 1});
+        (*histograms)[OperationOf(message)].Record(ReadTsc() - start);
+    }
+    double ticks_per_ns = TscTicksPerNanosecond();
+    for (size_t operation = 0; operation < kOperationCount; operation++) {
+        const LatencyHistogram &histogram = (*histograms)[operation];
+        if (histogram.TotalCount() == 0) {
+            continue;
+        }
+        std::string prefix = CounterPrefix(operation);
+        state.counters[prefix + "_p50_ns"] = histogram.ValueAtQuantile(0.5) / ticks_per_ns;
+        state.counters[prefix + "_p99_ns"] = histogram.ValueAtQuantile(0.99) / ticks_per_ns;
+        state.counters[prefix + "_p999_ns"] = histogram.ValueAtQuantile(0.999) / ticks_per_ns;
+    }
+}
+
+/*
+ *  Benchmark a generated flow of N messages (the data_generator.py mix) streamed into a book, for books and flows
+ *  larger than the caches. The flow is generated in blocks with the timer paused, only the matching is timed.
+ */
+static void BM_GeneratedFlow(benchmark::State &state) {
+    std::vector<OrderMessage> messages(4096);
+    std::vector<MessageResult> results(messages.size());
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto order_book = std::make_unique<ScenarioBook>();
+        OrderFlowGenerator generator;
+        for (int64_t left = state.range(0); left > 0; left -= messages.size()) {
+            generator.Next(messages);
+            state.ResumeTiming();
+            order_book->Apply(messages, results);
+            state.PauseTiming();
+        }
+        benchmark::DoNotOptimize(results);
+        order_book.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_Scenario, DeepPassiveBook)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Scenario, CancelHeavy)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Scenario, AggressiveSweeps)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Scenario, WideSparseRange)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Scenario, OscillatingPrices)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_GeneratedFlow)->Arg(1 << 20)->Arg(1 << 24)->Arg(1 << 26)->Iterations(1)->Unit(benchmark::kMillisecond);
@@ -1,6 +1,29 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
+#include "csv_message_reader.hpp"
+#include "depth_publisher.hpp"
+#include "depth_snapshot.hpp"
 #include "gtest/gtest.h"
+#include "ingest_sequencer.hpp"
+#include "journal.hpp"
+#include "latency_stats.hpp"
+#include "matching_engine.hpp"
 #include "order.hpp"
 #include "order_book.hpp"
+#include "order_flow_generator.hpp"
+#include "price_ladder.hpp"
+#include "spsc_channel.hpp"
 
 TEST(ProcessOrdersTestSuit, ExactBuyAndSell) {
     /* Case1: Test exact price matching trade with same amounts.
@@ -10,7 +33,7 @@ TEST(ProcessOrdersTestSuit, ExactBuyAndSell) {
     Order buy_order{OrderType::BUY, 1, 100, 5};
     Order sell_order{OrderType::SELL, 2, 100, 5};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(buy_order);
     orderBook.AddOrder(sell_order);
 
@@ -33,7 +56,7 @@ TEST(ProcessOrdersTestSuit, ExactBuyAndSellDifferentAmount) {
     Order buy_order{OrderType::BUY, 1, 105, 7};
     Order sell_order1{OrderType::SELL, 2, 105, 10};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(buy_order);
     orderBook.AddOrder(sell_order1);
 
@@ -62,7 +85,7 @@ TEST(ProcessOrdersTestSuit, BuyOrderForNewAndRemainingSell) {
     Order sell_order_5{OrderType::SELL, 5, 102, 3};
     Order buy_order_6{OrderType::BUY, 6, 110, 12};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(buy_order_3);
     orderBook.AddOrder(sell_order_4);
     orderBook.AddOrder(sell_order_5);
@@ -92,7 +115,7 @@ TEST(ProcessOrdersTestSuit, SellOrderFulfilledForRemainder) {
     Order sell_order_4{OrderType::SELL, 4, 119, 100};
     Order buy_order_5{OrderType::BUY, 5, 119, 1};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(sell_order_1);
     orderBook.AddOrder(buy_order_2);
     orderBook.AddOrder(buy_order_3);
@@ -129,7 +152,7 @@ TEST(ProcessOrdersTestSuit, LevelsDontMatch) {
     Order sellorder7{OrderType::SELL, 7, 101, 99};
     Order sellorder8{OrderType::SELL, 8, 1000, 1};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(buyorder1);
     orderBook.AddOrder(buyorder2);
     orderBook.AddOrder(buyorder3);
@@ -168,7 +191,7 @@ TEST(ProcessOrdersTestSuit, IncorrectInput) {
     Order sellorder7{OrderType::SELL, 17, 0, 5};      // zero price
     Order sellorder9{OrderType::SELL, 19, 200, 100};  // correct order just no match
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(buyorder1);
     EXPECT_THROW(orderBook.AddOrder(buyorder2), std::invalid_argument);
     orderBook.AddOrder(buyorder3);
@@ -202,7 +225,7 @@ TEST(ProcessOrdersTestSuit, CancelOneOrder) {
     Order buyorder1{OrderType::BUY, 1, 100, 5};
     Order sellorder1{OrderType::SELL, 2, 100, 5};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(buyorder1);
     orderBook.CancelOrderbyId(buyorder1.orderId);
     orderBook.AddOrder(sellorder1);
@@ -237,7 +260,7 @@ TEST(ProcessOrdersTestSuit, MultipleOrdersCancelOneOrder) {
     Order sellorder7{OrderType::SELL, 7, 101, 99};
     Order sellorder8{OrderType::SELL, 8, 1000, 1};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(buyorder1);
     orderBook.AddOrder(buyorder2);
     orderBook.AddOrder(buyorder3);
@@ -273,7 +296,7 @@ TEST(ProcessOrdersTestSuit, getBestBidTest) {
     Order buyorder7{OrderType::BUY, 7, 99, 1000};
     Order buyorder8{OrderType::BUY, 8, 99, 1000};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(buyorder1);
     orderBook.AddOrder(buyorder2);
     orderBook.AddOrder(buyorder3);
@@ -302,7 +325,7 @@ TEST(ProcessOrdersTestSuit, getBestAskTest) {
     Order sellorder6{OrderType::SELL, 6, 100, 15};  // price: 100, quantity: 40 overall
     Order sellorder7{OrderType::SELL, 7, 99, 1000};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(sellorder1);
     orderBook.AddOrder(sellorder2);
     orderBook.AddOrder(sellorder3);
@@ -330,7 +353,7 @@ TEST(ProcessOrdersTestSuit, getBestBidTestWithOnlyOnePrice) {
     Order buyorder5{OrderType::BUY, 5, 100, 5};
     Order buyorder6{OrderType::BUY, 6, 100, 15};  // price: 100, quantity: 40 overall
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(buyorder1);
     orderBook.AddOrder(buyorder2);
     orderBook.AddOrder(buyorder3);
@@ -357,7 +380,7 @@ TEST(ProcessOrdersTestSuit, getBestAskTestWithOnlyOnePrice) {
     Order sellorder5{OrderType::SELL, 5, 100, 5};
     Order sellorder6{OrderType::SELL, 6, 100, 15};  // price: 100, quantity: 40 overall
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(sellorder1);
     orderBook.AddOrder(sellorder2);
     orderBook.AddOrder(sellorder3);
@@ -376,7 +399,7 @@ TEST(ProcessOrdersTestSuit, getBestBidTest_NoVolume) {
      *  Checks if GetBestBidWithQuantity function returns 0 in case bid database is empty
      */
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
 
     std::pair<uint32_t, uint32_t> bid_info = orderBook.GetBestBidWithQuantity();
     std::pair<uint32_t, uint32_t> expected_bid_info = {0, 0};
@@ -389,7 +412,7 @@ TEST(ProcessOrdersTestSuit, getBestAskTest_NoVolume) {
      *  Checks if GetBestBidWithQuantity function returns 0 in case bid database is empty
      */
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
 
     std::pair<uint32_t, uint32_t> ask_info = orderBook.GetBestAskWithQuantity();
     std::pair<uint32_t, uint32_t> expected_ask_info = {0, 0};
@@ -406,7 +429,7 @@ TEST(ProcessOrdersTestSuit, getAskVolumeBetweenPrices) {
     Order sellorder2{OrderType::SELL, 2, 11, 10};
     Order sellorder3{OrderType::SELL, 3, 12, 5};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(sellorder1);
     orderBook.AddOrder(sellorder2);
     orderBook.AddOrder(sellorder3);
@@ -426,7 +449,7 @@ TEST(ProcessOrdersTestSuit, getAskVolumeBetweenPrices_WrongInput) {
     Order sellorder2{OrderType::SELL, 2, 11, 10};
     Order sellorder3{OrderType::SELL, 3, 12, 5};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(sellorder1);
     orderBook.AddOrder(sellorder2);
     orderBook.AddOrder(sellorder3);
@@ -442,7 +465,7 @@ TEST(ProcessOrdersTestSuit, getAskVolumeBetweenPrices_NoAsk) {
      *  Checks if GetVolumeBetweenPrices function returns zero in case of empty ask database
      */
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
 
     uint32_t ask_quantity_info = orderBook.GetVolumeBetweenPrices(11, 10);  // start>end wrong input
     int expected_ask_quantity_info = 0;
@@ -459,7 +482,7 @@ TEST(ProcessOrdersTestSuit, getAskVolumeBetweenPrices_BottomOfList) {
     Order sellorder2{OrderType::SELL, 2, 11, 10};
     Order sellorder3{OrderType::SELL, 3, 12, 5};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(sellorder1);
     orderBook.AddOrder(sellorder2);
     orderBook.AddOrder(sellorder3);
@@ -484,7 +507,7 @@ TEST(ProcessOrdersTestSuit, getAskVolumeBetweenPrices_OrdersCorrectAfter) {
     Order sellorder4{OrderType::SELL, 4, 12, 5};
     Order sellorder5{OrderType::SELL, 5, 13, 5};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(sellorder1);
     orderBook.AddOrder(sellorder2);
     orderBook.AddOrder(sellorder3);
@@ -524,7 +547,7 @@ TEST(ProcessOrdersTestSuit, GetBestBid) {
     Order buyorder2{OrderType::BUY, 2, 150, 5};
     Order buyorder3{OrderType::BUY, 3, 200, 5};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(buyorder1);
     orderBook.AddOrder(buyorder2);
     orderBook.AddOrder(buyorder3);
@@ -540,7 +563,7 @@ TEST(ProcessOrdersTestSuit, GetBestAsk) {
     Order sellorder2{OrderType::SELL, 2, 150, 5};
     Order sellorder3{OrderType::SELL, 3, 200, 5};
 
-    OrderBook orderBook;
+    RecordingOrderBook orderBook;
     orderBook.AddOrder(sellorder1);
     orderBook.AddOrder(sellorder2);
     orderBook.AddOrder(sellorder3);
@@ -550,3 +573,1318 @@ TEST(ProcessOrdersTestSuit, GetBestAsk) {
 
     ASSERT_EQ(actual_result, expected_result);
 }
+
+TEST(ProcessOrdersTestSuit, PriceLadderRecenter) {
+    /*
+     *  Prices far outside the initial ladder window force the ladder to recenter and grow,
+     *  levels and queued orders must survive the move and trades still happen in price-time priority.
+     */
+
+    Order buyorder1{OrderType::BUY, 1, 100, 5};
+    Order buyorder2{OrderType::BUY, 2, 50000, 5};
+    Order buyorder3{OrderType::BUY, 3, 50000, 7};
+    Order buyorder4{OrderType::BUY, 4, 3, 1};
+    Order sellorder5{OrderType::SELL, 5, 60000, 10};
+    Order sellorder6{OrderType::SELL, 6, 49999, 8};
+
+    RecordingOrderBook orderBook;
+    orderBook.AddOrder(buyorder1);
+    orderBook.AddOrder(buyorder2);
+    orderBook.AddOrder(buyorder3);
+    orderBook.AddOrder(buyorder4);
+    orderBook.AddOrder(sellorder5);
+
+    EXPECT_EQ(orderBook.GetBestBid(), 50000);
+    EXPECT_EQ(orderBook.GetBestAsk(), 60000);
+    EXPECT_EQ(orderBook.GetBidQuantity(), 18);
+
+    orderBook.AddOrder(sellorder6);
+
+    std::vector<trade> expected_trades = {{2, 6, 49999, 5, /* timestamp not compared */},
+                                          {3, 6, 49999, 3, /* timestamp not compared */}};
+
+    const std::vector<trade>& actual_trades = orderBook.GetTrades();
+    ASSERT_EQ(expected_trades.size(), actual_trades.size());
+    for (size_t i = 0; i < expected_trades.size(); ++i) {
+        EXPECT_EQ(expected_trades[i], actual_trades[i]);
+    }
+    std::pair<uint32_t, uint32_t> expected_bid_info = {50000, 4};
+    EXPECT_EQ(orderBook.GetBestBidWithQuantity(), expected_bid_info);
+
+    orderBook.CancelOrderbyId(buyorder3.orderId);
+    EXPECT_EQ(orderBook.GetBestBid(), 100);
+    EXPECT_EQ(orderBook.GetVolumeBetweenPrices(1, 1000000), 10);
+}
+
+TEST(ProcessOrdersTestSuit, PriceLadderFarApartPrices) {
+    /*
+     *  Resting prices two billion ticks apart cannot share one ladder window, the outlier levels go to the overflow
+     *  levels and the book behaves like the std::map book.
+     */
+    RecordingOrderBook orderBook;
+    orderBook.AddOrder({OrderType::BUY, 1, 1, 5});
+    orderBook.AddOrder({OrderType::BUY, 2, 2000000000, 7});
+    orderBook.AddOrder({OrderType::BUY, 3, 100, 3});
+    orderBook.AddOrder({OrderType::SELL, 4, UINT32_MAX, 2});
+    EXPECT_EQ(orderBook.GetBestBidWithQuantity(), (std::pair<uint32_t, uint32_t>{2000000000, 7}));
+    EXPECT_EQ(orderBook.GetBestAsk(), UINT32_MAX);
+    EXPECT_EQ(orderBook.GetBidQuantity(), 15);
+    std::array<DepthLevel, 4> depth;
+    ASSERT_EQ(orderBook.GetDepth(OrderType::BUY, depth), 3);
+    EXPECT_EQ(depth[0], (DepthLevel{2000000000, 7, 1}));
+    EXPECT_EQ(depth[1], (DepthLevel{100, 3, 1}));
+    EXPECT_EQ(depth[2], (DepthLevel{1, 5, 1}));
+
+    orderBook.AddOrder({OrderType::SELL, 5, 50, 10});  // sweeps the bids down to 50
+    std::vector<trade> expected_trades = {{2, 5, 50, 7, /* timestamp not compared */},
+                                          {3, 5, 50, 3, /* timestamp not compared */}};
+    const std::vector<trade>& actual_trades = orderBook.GetTrades();
+    ASSERT_EQ(expected_trades.size(), actual_trades.size());
+    for (size_t i = 0; i < expected_trades.size(); ++i) {
+        EXPECT_EQ(expected_trades[i], actual_trades[i]);
+    }
+    EXPECT_EQ(orderBook.GetBestBid(), 1);
+    orderBook.CancelOrderbyId(1);
+    orderBook.CancelOrderbyId(4);
+    EXPECT_EQ(orderBook.GetBidQuantity(), 0);
+    EXPECT_EQ(orderBook.GetAskQuantity(), 0);
+
+    // Random levels in three far apart clusters on a ladder capped at 64 ticks, checked against a std::map.
+    auto check_side = [](auto ladder, auto model) {
+        uint32_t state = 777;
+        auto next = [&state](uint32_t range) {
+            state = state * 1103515245 + 12345;
+            return (state >> 8) % range;
+        };
+        constexpr std::array<uint32_t, 3> kClusters = {1, 1000000, UINT32_MAX - 40};
+        auto random_price = [&] { return kClusters[next(3)] + next(40); };
+        for (int step = 0; step < 3000; step++) {
+            uint32_t price = random_price();
+            if (next(3) != 0) {
+                ladder.AddQuantity(ladder.FindOrCreate(price), 1 + price % 7);
+                model[price] += 1 + price % 7;
+            } else if (Level* level = ladder.Find(price)) {
+                ladder.ReduceQuantity(*level, level->quantity);
+                ladder.Remove(price);
+                model.erase(price);
+            } else {
+                EXPECT_EQ(model.count(price), 0);
+            }
+            std::vector<std::pair<uint32_t, uint32_t>> levels;
+            std::vector<std::pair<uint32_t, uint32_t>> expected_levels(model.begin(), model.end());
+            for (Level& level : ladder) levels.emplace_back(level.price, level.quantity);
+            ASSERT_EQ(levels, expected_levels);
+            if (!model.empty()) {
+                EXPECT_EQ(ladder.Best().price, model.begin()->first);
+            }
+            auto found = ladder.lower_bound(price);
+            auto expected = model.lower_bound(price);
+            EXPECT_EQ(found == ladder.end() ? 0 : found->price, expected == model.end() ? 0 : expected->first);
+            uint32_t low = std::min(price, random_price());
+            uint32_t high = std::max(price, random_price());
+            uint64_t volume = 0;
+            for (auto [level_price, quantity] : model) {
+                volume += level_price >= low && level_price <= high ? quantity : 0;
+            }
+            EXPECT_EQ(ladder.VolumeBetween(low, high), volume);
+        }
+    };
+    check_side(PriceLadder<std::greater<>>(16, 64), std::map<uint32_t, uint32_t, std::greater<>>());
+    check_side(PriceLadder<std::less<>>(16, 64), std::map<uint32_t, uint32_t, std::less<>>());
+}
+
+TEST(ProcessOrdersTestSuit, CancelFromMiddleOfLevelKeepsPriority) {
+    /*
+     *  Cancel the head, middle and tail orders of one level queue, then re-add orders that reuse the freed pool nodes.
+     *  Remaining orders must keep their time priority when a matching order arrives.
+     */
+
+    RecordingOrderBook orderBook;
+    for (uint32_t id = 1; id <= 6; id++) {
+        orderBook.AddOrder(Order{OrderType::SELL, id, 100, id});
+    }
+    orderBook.CancelOrderbyId(1);  // head
+    orderBook.CancelOrderbyId(3);  // middle
+    orderBook.CancelOrderbyId(6);  // tail
+    orderBook.AddOrder(Order{OrderType::SELL, 7, 100, 7});
+    EXPECT_EQ(orderBook.GetBestAskWithQuantity(), (std::pair<uint32_t, uint32_t>{100, 2 + 4 + 5 + 7}));
+
+    orderBook.AddOrder(Order{OrderType::BUY, 8, 100, 100});
+
+    std::vector<trade> expected_trades = {{8, 2, 100, 2, /* timestamp not compared */},
+                                          {8, 4, 100, 4, /* timestamp not compared */},
+                                          {8, 5, 100, 5, /* timestamp not compared */},
+                                          {8, 7, 100, 7, /* timestamp not compared */}};
+
+    const std::vector<trade>& actual_trades = orderBook.GetTrades();
+    ASSERT_EQ(expected_trades.size(), actual_trades.size());
+    for (size_t i = 0; i < expected_trades.size(); ++i) {
+        EXPECT_EQ(expected_trades[i], actual_trades[i]);
+    }
+    EXPECT_EQ(orderBook.GetAskQuantity(), 0);
+    EXPECT_EQ(orderBook.GetBestBidWithQuantity(), (std::pair<uint32_t, uint32_t>{100, 82}));
+}
+
+TEST(ProcessOrdersTestSuit, CancelAcrossIdIndexPages) {
+    /*
+     *  Order ids starting high and spanning several id index pages are cancelled in random order.
+     *  Unknown and already cancelled ids are ignored.
+     */
+
+    RecordingOrderBook orderBook;
+    const uint32_t first_id = 4000000000U;
+    const uint32_t order_count = 20000;
+    for (uint32_t i = 0; i < order_count; i++) {
+        if (i % 2) {
+            orderBook.AddOrder(Order{OrderType::BUY, first_id + i, 90 + i % 7, 1});
+        } else {
+            orderBook.AddOrder(Order{OrderType::SELL, first_id + i, 100 + i % 5, 1});
+        }
+    }
+    EXPECT_EQ(orderBook.GetBidQuantity(), order_count / 2);
+    EXPECT_EQ(orderBook.GetAskQuantity(), order_count / 2);
+
+    orderBook.CancelOrderbyId(1);  // unknown id, below the window
+    for (uint32_t i = 0; i < order_count; i++) {
+        uint32_t order_id = first_id + (i * 7919) % order_count;  // 7919 is prime, visits every id once
+        orderBook.CancelOrderbyId(order_id);
+        orderBook.CancelOrderbyId(order_id);  // second cancel is a no-op
+    }
+    EXPECT_EQ(orderBook.GetBidQuantity(), 0);
+    EXPECT_EQ(orderBook.GetAskQuantity(), 0);
+    EXPECT_TRUE(orderBook.GetTrades().empty());
+}
+
+TEST(ProcessOrdersTestSuit, getVolumeBetweenPrices_BothSidesAfterFills) {
+    /*
+     *  Checks that the ask and bid range volumes follow adds, partial fills and cancels, also for ranges much wider
+     *  than the book and ranges outside of it.
+     */
+
+    RecordingOrderBook orderBook;
+    orderBook.AddOrder(Order{OrderType::BUY, 1, 95, 10});
+    orderBook.AddOrder(Order{OrderType::BUY, 2, 97, 20});
+    orderBook.AddOrder(Order{OrderType::BUY, 3, 97, 5});
+    orderBook.AddOrder(Order{OrderType::SELL, 4, 101, 7});
+    orderBook.AddOrder(Order{OrderType::SELL, 5, 104, 3});
+
+    EXPECT_EQ(orderBook.GetBidVolumeBetweenPrices(1, 4000000000U), 35);
+    EXPECT_EQ(orderBook.GetBidVolumeBetweenPrices(96, 100), 25);
+    EXPECT_EQ(orderBook.GetBidVolumeBetweenPrices(98, 200), 0);
+    EXPECT_EQ(orderBook.GetVolumeBetweenPrices(0, 4000000000U), 10);
+
+    orderBook.AddOrder(Order{OrderType::SELL, 6, 96, 22});  // fills order 2 and 2 of order 3
+    EXPECT_EQ(orderBook.GetBidVolumeBetweenPrices(96, 100), 3);
+    EXPECT_EQ(orderBook.GetBidVolumeBetweenPrices(90, 100), 13);
+
+    orderBook.CancelOrderbyId(4);
+    EXPECT_EQ(orderBook.GetVolumeBetweenPrices(100, 104), 3);
+    EXPECT_EQ(orderBook.GetAskQuantity(), 3);
+    EXPECT_EQ(orderBook.GetBidQuantity(), 13);
+}
+
+TEST(ProcessOrdersTestSuit, ApplyBatchMatchesSequential) {
+    /*
+     *  A packet applied with OrderBook::Apply must produce the same trades, query answers and book state as
+     *  calling the single message functions one by one. Invalid orders are reported instead of thrown.
+     */
+
+    std::vector<OrderMessage> messages;
+    auto add = [&messages](OrderType type, uint32_t id, uint32_t price, uint32_t quantity) {
+        messages.push_back({OrderMessageType::ADD_ORDER, {type, id, price, quantity}});
+    };
+    auto cancel = [&messages](uint32_t id) {
+        messages.push_back({OrderMessageType::CANCEL_ORDER, {OrderType::UNDEFINED, id}});
+    };
+    add(OrderType::BUY, 1, 100, 5);
+    add(OrderType::BUY, 2, 101, 7);
+    add(OrderType::SELL, 3, 105, 4);
+    messages.push_back({OrderMessageType::GET_BEST_BID, {}});
+    add(OrderType::SELL, 4, 100, 9);  // crosses: fills order 2 and 2 of order 1
+    cancel(1);
+    add(OrderType::SELL, 5, 102, 3);
+    messages.push_back({OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES, {}, 100, 110});
+    add(OrderType::BUY, 6, 110, 10);  // sweeps both ask levels
+    cancel(3);                         // already filled
+    add(OrderType::BUY, 7, 99, 1);
+
+    std::vector<MessageResult> results(messages.size());
+    RecordingOrderBook batch_book;
+    ASSERT_EQ(batch_book.Apply(messages, results), messages.size());
+
+    RecordingOrderBook sequential_book;
+    for (const OrderMessage& message : messages) {
+        if (message.order_message_type == OrderMessageType::ADD_ORDER) {
+            sequential_book.AddOrder(message.order);
+        } else if (message.order_message_type == OrderMessageType::CANCEL_ORDER) {
+            sequential_book.CancelOrderbyId(message.order.orderId);
+        }
+    }
+
+    const std::vector<trade>& batch_trades = batch_book.GetTrades();
+    const std::vector<trade>& sequential_trades = sequential_book.GetTrades();
+    ASSERT_EQ(batch_trades.size(), 4);
+    ASSERT_EQ(batch_trades.size(), sequential_trades.size());
+    for (size_t i = 0; i < batch_trades.size(); ++i) {
+        EXPECT_EQ(batch_trades[i], sequential_trades[i]);
+    }
+    EXPECT_EQ(batch_book.GetBestBidWithQuantity(), sequential_book.GetBestBidWithQuantity());
+    EXPECT_EQ(batch_book.GetBestAskWithQuantity(), sequential_book.GetBestAskWithQuantity());
+
+    EXPECT_EQ(results[3], (MessageResult{MessageStatus::OK, 101, 7}));
+    EXPECT_EQ(results[7], (MessageResult{MessageStatus::OK, 0, 7}));
+    EXPECT_EQ(results[9].status, MessageStatus::UNKNOWN_ORDER_ID);
+
+    // Rejections do not throw and leave the book untouched.
+    std::vector<OrderMessage> invalid = {{OrderMessageType::ADD_ORDER, {OrderType::BUY, 8, 100, 0}},
+                                         {OrderMessageType::ADD_ORDER, {OrderType::BUY, 7, 100, 1}},
+                                         {OrderMessageType::ADD_ORDER, {OrderType::BUY, 9, 0, 1}},
+                                         {OrderMessageType::ADD_ORDER, {OrderType::UNDEFINED, 10, 100, 1}},
+                                         {OrderMessageType::UNDEFINED, {}}};
+    std::vector<MessageResult> invalid_results(invalid.size());
+    batch_book.Apply(invalid, invalid_results);
+    EXPECT_EQ(invalid_results[0].status, MessageStatus::INVALID_QUANTITY);
+    EXPECT_EQ(invalid_results[1].status, MessageStatus::INVALID_ORDER_ID);
+    EXPECT_EQ(invalid_results[2].status, MessageStatus::INVALID_PRICE);
+    EXPECT_EQ(invalid_results[3].status, MessageStatus::IGNORED);
+    EXPECT_EQ(invalid_results[4].status, MessageStatus::IGNORED);
+    EXPECT_EQ(batch_book.GetBidQuantity(), sequential_book.GetBidQuantity());
+}
+
+TEST(ProcessOrdersTestSuit, RingBufferSinkReportsEvents) {
+    /* The default book reports fills, cancels, rejects and level changes to its ring buffer, in order. A full ring
+     * drops and counts events instead of blocking the book.
+     */
+    OrderBook orderBook(8);
+    orderBook.AddOrder({OrderType::BUY, 1, 100, 5});
+    orderBook.AddOrder({OrderType::SELL, 2, 100, 3});
+    orderBook.CancelOrderbyId(1);
+    orderBook.CancelOrderbyId(1);
+    EXPECT_THROW(orderBook.AddOrder({OrderType::SELL, 3, 100, 0}), std::invalid_argument);
+
+    std::vector<BookEvent> events;
+    orderBook.GetEventSink().Drain([&events](const BookEvent& event) { events.push_back(event); });
+    ASSERT_EQ(events.size(), 8);
+    EXPECT_EQ(events[0].type, BookEventType::LEVEL_CHANGE);  // bid 100 -> 5
+    EXPECT_EQ(events[0].quantity, 5);
+    EXPECT_EQ(events[0].order_count, 1);
+    EXPECT_EQ(events[1].type, BookEventType::LEVEL_CHANGE);  // ask 100 -> 3
+    EXPECT_EQ(events[2].type, BookEventType::TRADE);
+    EXPECT_EQ(events[2].order_id, 1);
+    EXPECT_EQ(events[2].sell_order_id, 2);
+    EXPECT_EQ(events[2].price, 100);
+    EXPECT_EQ(events[2].quantity, 3);
+    EXPECT_EQ(events[3].type, BookEventType::LEVEL_CHANGE);  // bid 100 -> 2
+    EXPECT_EQ(events[3].side, OrderType::BUY);
+    EXPECT_EQ(events[3].quantity, 2);
+    EXPECT_EQ(events[4].type, BookEventType::LEVEL_CHANGE);  // ask 100 -> 0
+    EXPECT_EQ(events[4].side, OrderType::SELL);
+    EXPECT_EQ(events[4].quantity, 0);
+    EXPECT_EQ(events[4].order_count, 0);
+    EXPECT_EQ(events[5].type, BookEventType::CANCEL);
+    EXPECT_EQ(events[5].quantity, 2);
+    EXPECT_EQ(events[6].type, BookEventType::LEVEL_CHANGE);  // bid 100 -> 0
+    EXPECT_EQ(events[7].type, BookEventType::REJECT);
+    EXPECT_EQ(events[7].reason, MessageStatus::UNKNOWN_ORDER_ID);
+    EXPECT_EQ(orderBook.GetEventSink().DroppedCount(), 1);  // the invalid quantity reject did not fit
+
+    orderBook.AddOrder({OrderType::SELL, 4, 101, 1});
+    EXPECT_EQ(orderBook.GetEventSink().Drain([](const BookEvent&) {}), 1);
+}
+
+TEST(ProcessOrdersTestSuit, MatchingEngineMatchesPerSymbolBooks) {
+    /* Messages of 5 symbols matched on 3 shards: the merged results come in submission order and every book ends up
+     * with the trades of a single book fed only its own symbol's messages.
+     */
+    constexpr SymbolId kSymbols = 5;
+    std::vector<OrderMessage> messages;
+    for (uint32_t id = 1; id <= 3000; id++) {
+        SymbolId symbol = (id * 7) % kSymbols;
+        OrderType side = (id * 13) % 3 == 0 ? OrderType::SELL : OrderType::BUY;
+        messages.push_back({OrderMessageType::ADD_ORDER, {side, id, 100 + (id * 31) % 9, 1 + id % 17}, 0, 0, symbol});
+        if (id % 5 == 0) {
+            messages.push_back({OrderMessageType::CANCEL_ORDER, {OrderType::UNDEFINED, id - 3}, 0, 0, symbol});
+        }
+        if (id % 11 == 0) {
+            messages.push_back({OrderMessageType::GET_BEST_BID, {}, 0, 0, symbol});
+        }
+    }
+
+    std::vector<SequencedResult> results;
+    auto collect = [&results](const SequencedResult& result) { results.push_back(result); };
+    BasicMatchingEngine<TradeRecorder> engine({.shard_count = 3, .queue_capacity = 16, .pin_threads = false});
+    for (const OrderMessage& message : messages) {
+        engine.Submit(message, collect);
+    }
+    engine.Flush(collect);
+    ASSERT_EQ(results.size(), messages.size());
+
+    for (SymbolId symbol = 0; symbol < kSymbols; symbol++) {
+        RecordingOrderBook expected_book;
+        for (size_t i = 0; i < messages.size(); i++) {
+            if (messages[i].symbol_id != symbol) continue;
+            MessageResult expected;
+            expected_book.Apply({&messages[i], 1}, {&expected, 1});
+            EXPECT_EQ(results[i].sequence, i);
+            EXPECT_EQ(results[i].symbol_id, symbol);
+            EXPECT_EQ(results[i].result, expected);
+        }
+        auto* book = engine.FindBook(symbol);
+        ASSERT_NE(book, nullptr);
+        EXPECT_EQ(book->GetTrades(), expected_book.GetTrades());
+        EXPECT_EQ(book->GetBestAskWithQuantity(), expected_book.GetBestAskWithQuantity());
+    }
+    EXPECT_EQ(engine.FindBook(kSymbols), nullptr);
+}
+
+template <typename WaitStrategy>
+void ExpectLosslessHandOff(size_t capacity, uint32_t item_count) {
+    // A small channel forces both sides to wait: every item arrives once and in order, then the closed channel drains.
+    SpscChannel<uint32_t, WaitStrategy> channel(capacity);
+    std::thread producer([&channel, item_count] {
+        std::array<uint32_t, 7> batch;
+        for (uint32_t next = 0; next < item_count;) {
+            size_t count = std::min<size_t>(batch.size(), item_count - next);
+            for (size_t i = 0; i < count; i++) batch[i] = next++;
+            channel.Push({batch.data(), count});
+        }
+        channel.Close();
+    });
+    std::array<uint32_t, 5> out;
+    uint32_t expected = 0;
+    bool in_order = true;
+    while (size_t count = channel.Pop(out)) {
+        for (size_t i = 0; i < count; i++) in_order &= out[i] == expected++;
+    }
+    producer.join();
+    EXPECT_TRUE(in_order);
+    EXPECT_EQ(expected, item_count);
+    uint32_t item;
+    EXPECT_FALSE(channel.Pop(item));
+}
+
+TEST(ProcessOrdersTestSuit, MatchingEngineStreamsExecutionReports) {
+    /* The execution reports of the shard books are merged with the results: every message is followed by nothing but
+     * its own reports and then its result, in submission order. Sweeps make more reports than the tiny queues hold.
+     */
+    std::vector<OrderMessage> messages;
+    for (uint32_t id = 1; id <= 600; id++) {
+        SymbolId symbol = id % 2;
+        if (id % 50 == 0) {
+            messages.push_back({OrderMessageType::ADD_ORDER, {OrderType::BUY, id, 200, 400}, 0, 0, symbol});
+        } else {
+            messages.push_back({OrderMessageType::ADD_ORDER, {OrderType::SELL, id, 100 + id % 7, 1 + id % 5}, 0, 0,
+                                symbol});
+        }
+    }
+    messages.push_back({OrderMessageType::CANCEL_ORDER, {OrderType::UNDEFINED, 10000}, 0, 0, 1});
+
+    using ReportLog = std::vector<std::tuple<uint64_t, bool, BookEventType, uint32_t, uint32_t>>;
+    ReportLog stream;
+    BasicMatchingEngine<> engine({.shard_count = 2,
+                                  .queue_capacity = 4,
+                                  .pin_threads = false,
+                                  .book_sizing = {.reserved_orders = 0, .slab_orders = 64, .ladder_ticks = 64}});
+    auto on_result = [&](const SequencedResult& result) {
+        stream.emplace_back(result.sequence, false, BookEventType{}, 0, 0);
+    };
+    auto on_report = [&](const SequencedReport& report) {
+        stream.emplace_back(report.sequence, true, report.event.type, report.event.order_id, report.event.quantity);
+    };
+    for (const OrderMessage& message : messages) {
+        engine.Submit(message, on_result, on_report);
+    }
+    engine.Flush(on_result, on_report);
+
+    ReportLog expected;
+    std::array<std::unique_ptr<BasicOrderBook<ShardEventSink<NullEventSink>>>, 2> books;
+    size_t trades = 0;
+    for (size_t i = 0; i < messages.size(); i++) {
+        auto& book = books[messages[i].symbol_id];
+        if (!book) {
+            book = std::make_unique<BasicOrderBook<ShardEventSink<NullEventSink>>>();
+            book->GetEventSink().KeepReports(true);
+        }
+        MessageResult result;
+        book->Apply({&messages[i], 1}, {&result, 1});
+        for (const BookEvent& event : book->GetEventSink().Reports()) {
+            expected.emplace_back(i, true, event.type, event.order_id, event.quantity);
+            trades += event.type == BookEventType::TRADE;
+        }
+        book->GetEventSink().Reports().clear();
+        expected.emplace_back(i, false, BookEventType{}, 0, 0);
+    }
+    EXPECT_GT(trades, 100);
+    EXPECT_EQ(std::get<2>(expected[expected.size() - 2]), BookEventType::REJECT);
+    EXPECT_EQ(stream, expected);
+}
+
+TEST(ProcessOrdersTestSuit, SpscChannelIsLossless) {
+    if (std::thread::hardware_concurrency() > 1) {
+        ExpectLosslessHandOff<BusySpinWait>(1024, 10000);  // a spinning side needs a core of its own
+    }
+    ExpectLosslessHandOff<SpinThenYieldWait>(3, 100000);
+    ExpectLosslessHandOff<FutexWait>(3, 100000);
+    EXPECT_EQ(SpscChannel<uint32_t>(3).Capacity(), 4);
+    EXPECT_THROW((SpscChannel<uint32_t>(0)), std::invalid_argument);
+}
+
+TEST(ProcessOrdersTestSuit, LatencyHistogramBuckets) {
+    /* Every value falls in a bucket whose limit is at most ~3% above it, the buckets are ordered like the values, and
+     * the dump reports what the thread recorded.
+     */
+    size_t previous_bucket = 0;
+    for (uint64_t value : std::initializer_list<uint64_t>{0, 1, 63, 64, 65, 1000, 123456789, 1ull << 40, UINT64_MAX}) {
+        size_t bucket = LatencyHistogram::BucketOf(value);
+        ASSERT_LT(bucket, LatencyHistogram::kBucketCount);
+        EXPECT_GE(bucket, previous_bucket);
+        EXPECT_GE(LatencyHistogram::BucketLimit(bucket), value);
+        EXPECT_LE(LatencyHistogram::BucketLimit(bucket) - value, value / 32);
+        previous_bucket = bucket;
+    }
+    EXPECT_EQ(LatencyHistogram::BucketOf(LatencyHistogram::BucketLimit(100) + 1), 101);
+
+    LatencyRecorder& recorder = ThreadLatencyRecorder();
+    recorder.RecordServiceTime(OrderMessageType::CANCEL_ORDER, 100);
+    EXPECT_EQ(recorder.ServiceTime(OrderMessageType::CANCEL_ORDER).BucketCount(LatencyHistogram::BucketOf(100)), 1);
+    std::ostringstream dump;
+    DumpLatencyStats(dump);
+    EXPECT_NE(dump.str().find("CancelOrder"), std::string::npos);
+}
+
+TEST(ProcessOrdersTestSuit, GetDepthTopLevels) {
+    /* GetDepth fills the best levels of a side with price, quantity and order count, best first, and stops at the
+     * buffer size or the last level.
+     */
+    RecordingOrderBook orderBook;
+    orderBook.AddOrder({OrderType::BUY, 1, 100, 5});
+    orderBook.AddOrder({OrderType::BUY, 2, 98, 7});
+    orderBook.AddOrder({OrderType::BUY, 3, 100, 2});
+    orderBook.AddOrder({OrderType::BUY, 4, 99, 1});
+    orderBook.AddOrder({OrderType::SELL, 5, 103, 4});
+    orderBook.AddOrder({OrderType::SELL, 6, 101, 6});
+    orderBook.CancelOrderbyId(4);
+
+    std::array<DepthLevel, 3> depth;
+    ASSERT_EQ(orderBook.GetDepth(OrderType::BUY, depth), 2);
+    EXPECT_EQ(depth[0], (DepthLevel{100, 7, 2}));
+    EXPECT_EQ(depth[1], (DepthLevel{98, 7, 1}));
+    ASSERT_EQ(orderBook.GetDepth(OrderType::SELL, {depth.data(), 1}), 1);
+    EXPECT_EQ(depth[0], (DepthLevel{101, 6, 1}));
+    EXPECT_EQ(orderBook.GetDepth(OrderType::UNDEFINED, depth), 0);
+}
+
+TEST(ProcessOrdersTestSuit, DepthPublisherCoalescesChanges) {
+    /* Only the levels that changed since the last publish are emitted, once each with their latest state, also when
+     * a batch touches more levels than the initial table holds.
+     */
+    BasicOrderBook<DepthTrackingSink<TradeRecorder>> orderBook;
+    std::vector<DepthUpdate> updates;
+    auto collect = [&updates](const DepthUpdate& update) { updates.push_back(update); };
+
+    orderBook.AddOrder({OrderType::BUY, 1, 100, 5});
+    orderBook.AddOrder({OrderType::BUY, 2, 100, 3});
+    orderBook.AddOrder({OrderType::SELL, 3, 102, 4});
+    orderBook.AddOrder({OrderType::SELL, 4, 100, 6});  // fills order 1, leaves 2 of order 2
+    EXPECT_EQ(orderBook.GetEventSink().Depth().Publish(collect), 3);
+    ASSERT_EQ(updates.size(), 3);
+    EXPECT_EQ(updates[0], (DepthUpdate{OrderType::BUY, {100, 2, 1}}));
+    EXPECT_EQ(updates[1], (DepthUpdate{OrderType::SELL, {102, 4, 1}}));
+    EXPECT_EQ(updates[2], (DepthUpdate{OrderType::SELL, {100, 0, 0}}));
+    EXPECT_EQ(orderBook.GetTrades().size(), 2);
+
+    updates.clear();
+    EXPECT_EQ(orderBook.GetEventSink().Depth().Publish(collect), 0);
+    orderBook.CancelOrderbyId(3);
+    orderBook.AddOrder({OrderType::SELL, 5, 102, 1});
+    for (uint32_t i = 0; i < 200; i++) {
+        orderBook.AddOrder({OrderType::BUY, 6 + i, 1 + i % 90, 1});
+    }
+    orderBook.GetEventSink().Depth().Publish(collect);
+    ASSERT_EQ(updates.size(), 91);
+    EXPECT_EQ(updates[0], (DepthUpdate{OrderType::BUY, {1, 3, 3}}));
+    EXPECT_EQ(updates[89], (DepthUpdate{OrderType::BUY, {90, 2, 2}}));
+    EXPECT_EQ(updates[90], (DepthUpdate{OrderType::SELL, {102, 1, 1}}));
+
+    std::array<DepthLevel, 10> top;
+    ASSERT_EQ(orderBook.GetDepth(OrderType::BUY, top), 10);
+    EXPECT_EQ(top[0], (DepthLevel{100, 2, 1}));
+    EXPECT_EQ(top[1], (DepthLevel{90, 2, 2}));
+}
+
+TEST(ProcessOrdersTestSuit, ModifyReduceKeepsPriority) {
+    /* Reducing an order at the same price keeps its place in the queue, a size increase sends it to the back.
+     */
+    RecordingOrderBook orderBook;
+    orderBook.AddOrder({OrderType::BUY, 1, 100, 5});
+    orderBook.AddOrder({OrderType::BUY, 2, 100, 5});
+    orderBook.AddOrder({OrderType::BUY, 3, 100, 5});
+    orderBook.ModifyOrder(1, 100, 2);  // still first
+    orderBook.ModifyOrder(2, 100, 6);  // now last
+    EXPECT_EQ(orderBook.GetBestBidWithQuantity(), std::make_pair(100u, 13u));
+
+    orderBook.AddOrder({OrderType::SELL, 4, 100, 8});
+    const std::vector<trade>& trades = orderBook.GetTrades();
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[0].buy_order_id, 1);
+    EXPECT_EQ(trades[0].quantity, 2);
+    EXPECT_EQ(trades[1].buy_order_id, 3);
+    EXPECT_EQ(trades[1].quantity, 5);
+    EXPECT_EQ(trades[2].buy_order_id, 2);
+    EXPECT_EQ(trades[2].quantity, 1);
+    EXPECT_EQ(orderBook.GetBestBidWithQuantity(), std::make_pair(100u, 5u));
+}
+
+TEST(ProcessOrdersTestSuit, ModifyPriceMovesAndMatches) {
+    /* A new price moves the order to its new level, releases the empty old level and trades when it crosses.
+     */
+    RecordingOrderBook orderBook;
+    orderBook.AddOrder({OrderType::BUY, 1, 98, 5});
+    orderBook.AddOrder({OrderType::SELL, 2, 101, 3});
+    orderBook.ModifyOrder(1, 99, 5);
+    EXPECT_EQ(orderBook.GetBestBidWithQuantity(), std::make_pair(99u, 5u));
+    EXPECT_EQ(orderBook.GetBidVolumeBetweenPrices(98, 98), 0);
+
+    orderBook.ModifyOrder(1, 102, 4);  // crosses, trades at the resting ask price
+    const std::vector<trade>& trades = orderBook.GetTrades();
+    ASSERT_EQ(trades.size(), 1);
+    EXPECT_EQ(trades[0].buy_order_id, 1);
+    EXPECT_EQ(trades[0].sell_order_id, 2);
+    EXPECT_EQ(trades[0].price, 101);
+    EXPECT_EQ(trades[0].quantity, 3);
+    EXPECT_EQ(orderBook.GetBestBidWithQuantity(), std::make_pair(102u, 1u));
+    EXPECT_EQ(orderBook.GetBestAsk(), 0);
+
+    orderBook.CancelOrderbyId(1);  // the modified order kept its id
+    EXPECT_EQ(orderBook.GetBidQuantity(), 0);
+}
+
+TEST(ProcessOrdersTestSuit, ModifyInvalidInput) {
+    /* Invalid values throw like AddOrder, unknown ids are ignored like CancelOrderbyId, Apply reports both.
+     */
+    RecordingOrderBook orderBook;
+    orderBook.AddOrder({OrderType::SELL, 1, 100, 5});
+    EXPECT_THROW(orderBook.ModifyOrder(1, 100, 0), std::invalid_argument);
+    EXPECT_THROW(orderBook.ModifyOrder(1, 0, 5), std::invalid_argument);
+    EXPECT_NO_THROW(orderBook.ModifyOrder(7, 100, 5));
+    EXPECT_EQ(orderBook.GetBestAskWithQuantity(), std::make_pair(100u, 5u));
+
+    std::vector<OrderMessage> messages = {{OrderMessageType::MODIFY_ORDER, {OrderType::UNDEFINED, 1, 101, 4}},
+                                          {OrderMessageType::MODIFY_ORDER, {OrderType::UNDEFINED, 7, 101, 4}},
+                                          {OrderMessageType::MODIFY_ORDER, {OrderType::UNDEFINED, 1, 101, 0}}};
+    std::vector<MessageResult> results(messages.size());
+    orderBook.Apply(messages, results);
+    EXPECT_EQ(results[0].status, MessageStatus::OK);
+    EXPECT_EQ(results[1].status, MessageStatus::UNKNOWN_ORDER_ID);
+    EXPECT_EQ(results[2].status, MessageStatus::INVALID_QUANTITY);
+    EXPECT_EQ(orderBook.GetBestAskWithQuantity(), std::make_pair(101u, 4u));
+}
+
+TEST(ProcessOrdersTestSuit, ImmediateOrdersNeverRest) {
+    /* MARKET and IOC orders trade what they can at the resting prices and the rest is cancelled, nothing of them is
+     * left in the book.
+     */
+    BasicOrderBook<DepthTrackingSink<TradeRecorder>> orderBook;
+    orderBook.AddOrder({OrderType::SELL, 1, 101, 4});
+    orderBook.AddOrder({OrderType::SELL, 2, 102, 4});
+    orderBook.AddOrder({OrderType::SELL, 3, 104, 4});
+    orderBook.GetEventSink().Depth().Publish([](const DepthUpdate&) {});
+
+    orderBook.AddOrder({OrderType::BUY, 4, 102, 10, OrderKind::IOC});
+    const std::vector<trade>& trades = orderBook.GetTrades();
+    ASSERT_EQ(trades.size(), 2);
+    EXPECT_EQ(trades[0].buy_order_id, 4);
+    EXPECT_EQ(trades[0].sell_order_id, 1);
+    EXPECT_EQ(trades[0].price, 101);
+    EXPECT_EQ(trades[1].price, 102);
+    EXPECT_EQ(orderBook.GetBestBid(), 0);  // the remaining 2 are cancelled
+    EXPECT_EQ(orderBook.GetBestAskWithQuantity(), std::make_pair(104u, 4u));
+    EXPECT_EQ(orderBook.GetEventSink().Depth().PendingCount(), 2);  // only the asks changed
+
+    orderBook.AddOrder({OrderType::BUY, 5, 0, 3, OrderKind::MARKET});
+    ASSERT_EQ(trades.size(), 3);
+    EXPECT_EQ(trades[2].price, 104);
+    EXPECT_EQ(orderBook.GetBestAskWithQuantity(), std::make_pair(104u, 1u));
+
+    orderBook.AddOrder({OrderType::BUY, 6, 100, 5});
+    orderBook.AddOrder({OrderType::SELL, 7, 0, 9, OrderKind::MARKET});  // takes the bid, the rest is cancelled
+    ASSERT_EQ(trades.size(), 4);
+    EXPECT_EQ(trades[3].buy_order_id, 6);
+    EXPECT_EQ(trades[3].sell_order_id, 7);
+    EXPECT_EQ(trades[3].price, 100);
+    EXPECT_EQ(orderBook.GetBestBid(), 0);
+    EXPECT_EQ(orderBook.GetBestAskWithQuantity(), std::make_pair(104u, 1u));
+    EXPECT_THROW(orderBook.AddOrder({OrderType::BUY, 8, 0, 1, OrderKind::IOC}), std::invalid_argument);
+}
+
+TEST(ProcessOrdersTestSuit, FillOrKill) {
+    /* A FOK order trades its whole quantity or nothing, the check does not touch the resting orders.
+     */
+    RecordingOrderBook orderBook;
+    orderBook.AddOrder({OrderType::BUY, 1, 100, 3});
+    orderBook.AddOrder({OrderType::BUY, 2, 99, 3});
+    orderBook.AddOrder({OrderType::BUY, 3, 97, 3});
+
+    std::vector<OrderMessage> messages = {{OrderMessageType::ADD_ORDER, {OrderType::SELL, 4, 99, 7, OrderKind::FOK}},
+                                          {OrderMessageType::ADD_ORDER, {OrderType::SELL, 5, 99, 6, OrderKind::FOK}},
+                                          {OrderMessageType::ADD_ORDER, {OrderType::SELL, 6, 90, 3, OrderKind::IOC}}};
+    std::vector<MessageResult> results(messages.size());
+    orderBook.Apply(messages, results);
+    EXPECT_EQ(results[0], (MessageResult{MessageStatus::OK, 0, 0}));  // killed, 6 available down to 99
+    EXPECT_EQ(results[1], (MessageResult{MessageStatus::OK, 0, 6}));
+    EXPECT_EQ(results[2], (MessageResult{MessageStatus::OK, 0, 3}));
+    ASSERT_EQ(orderBook.GetTrades().size(), 3);
+    EXPECT_EQ(orderBook.GetTrades()[2].buy_order_id, 3);
+    EXPECT_EQ(orderBook.GetBestBid(), 0);
+    EXPECT_EQ(orderBook.GetBestAsk(), 0);
+}
+
+// Pseudo random flow of adds, cancels, modifies, taker orders and queries.
+std::vector<OrderMessage> MixedFlow() {
+    std::vector<OrderMessage> messages;
+    uint32_t state = 12345;
+    auto next = [&state](uint32_t range) {
+        state = state * 1103515245 + 12345;
+        return (state >> 8) % range;
+    };
+    for (uint32_t id = 1; id <= 3000; id++) {
+        OrderType side = next(2) == 0 ? OrderType::BUY : OrderType::SELL;
+        uint32_t price = side == OrderType::BUY ? 95 + next(8) : 99 + next(8);
+        Order order{side, id, price, 1 + next(50), next(10) == 0 ? OrderKind::IOC : OrderKind::LIMIT};
+        messages.push_back({OrderMessageType::ADD_ORDER, order});
+        uint32_t other_id = 1 + next(id);
+        switch (next(4)) {
+            case 0:
+                messages.push_back({OrderMessageType::CANCEL_ORDER, {OrderType::UNDEFINED, other_id}});
+                break;
+            case 1:
+                messages.push_back(
+                    {OrderMessageType::MODIFY_ORDER, {OrderType::UNDEFINED, other_id, 97 + next(6), 1 + next(50)}});
+                break;
+            case 2:
+                messages.push_back({OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES, {}, 100, 103});
+                break;
+            default:
+                messages.push_back({OrderMessageType::GET_BEST_BID, {}});
+        }
+    }
+    return messages;
+}
+
+// Apply the MixedFlow() to a new Book, returns the trades and results.
+template <typename Book>
+std::pair<std::vector<trade>, std::vector<MessageResult>> ReplayMixedFlow() {
+    std::vector<OrderMessage> messages = MixedFlow();
+    Book book;
+    std::vector<MessageResult> results(messages.size());
+    book.Apply(messages, results);
+    return {book.GetTrades(), results};
+}
+
+TEST(ProcessOrdersTestSuit, BookPoliciesAgree) {
+    /* Every data structure policy must produce the same trades and query results.
+     */
+    auto [trades, results] = ReplayMixedFlow<RecordingOrderBook>();
+    ASSERT_GT(trades.size(), 100);
+    auto expect_same = [&](const auto& replay) {
+        ASSERT_EQ(replay.first.size(), trades.size());
+        for (size_t i = 0; i < trades.size(); i++) {
+            EXPECT_EQ(replay.first[i], trades[i]);
+        }
+        EXPECT_EQ(replay.second, results);
+    };
+    expect_same(ReplayMixedFlow<BasicOrderBook<TradeRecorder, MapBookPolicy>>());
+    expect_same(ReplayMixedFlow<BasicOrderBook<TradeRecorder, VectorQueueBookPolicy>>());
+    using MapVectorPolicy = BookPolicy<MapPriceLevels, VectorOrderQueue, HashOrderIdIndex>;
+    expect_same(ReplayMixedFlow<BasicOrderBook<TradeRecorder, MapVectorPolicy>>());
+}
+
+TEST(ProcessOrdersTestSuit, SnapshotRestoresBook) {
+    /* A restored book has the same levels, queue priorities and order id rule as the saved one, and keeps matching
+     * like it.
+     */
+    const std::string path = testing::TempDir() + "order_book_snapshot.bin";
+    RecordingOrderBook saved;
+    saved.AddOrder({OrderType::BUY, 1, 100, 5});
+    saved.AddOrder({OrderType::BUY, 2, 99, 3});
+    saved.AddOrder({OrderType::BUY, 3, 100, 4});
+    saved.AddOrder({OrderType::SELL, 4, 103, 6});
+    saved.AddOrder({OrderType::SELL, 5, 102, 2});
+    saved.AddOrder({OrderType::BUY, 6, 1000000, 1, OrderKind::IOC});  // takes order 5, never rests
+    saved.ModifyOrder(1, 100, 2);
+    saved.SaveSnapshot(path, 42);
+
+    RecordingOrderBook restored;
+    EXPECT_EQ(restored.LoadSnapshot(path), 42);
+    for (OrderType side : {OrderType::BUY, OrderType::SELL}) {
+        std::array<DepthLevel, 4> expected_depth;
+        std::array<DepthLevel, 4> depth;
+        ASSERT_EQ(restored.GetDepth(side, depth), saved.GetDepth(side, expected_depth));
+        EXPECT_EQ(depth, expected_depth);
+    }
+    EXPECT_EQ(restored.GetVolumeBetweenPrices(100, 103), saved.GetVolumeBetweenPrices(100, 103));
+    EXPECT_THROW(restored.AddOrder({OrderType::BUY, 6, 100, 1}), std::invalid_argument);
+    EXPECT_THROW(restored.LoadSnapshot(path), std::runtime_error);
+
+    for (RecordingOrderBook* book : {&saved, &restored}) {
+        book->CancelOrderbyId(2);
+        book->AddOrder({OrderType::SELL, 7, 100, 5});
+    }
+    ASSERT_EQ(restored.GetTrades().size(), 2);
+    EXPECT_EQ(restored.GetTrades()[0], saved.GetTrades()[1]);
+    EXPECT_EQ(restored.GetTrades()[0].buy_order_id, 1);
+    EXPECT_EQ(restored.GetTrades()[1], saved.GetTrades()[2]);
+    EXPECT_EQ(restored.GetBestBidWithQuantity(), std::make_pair(100u, 1u));
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a snapshot";
+    RecordingOrderBook corrupt;
+    EXPECT_THROW(corrupt.LoadSnapshot(path), std::runtime_error);
+
+    // a duplicate order id, crossed sides or levels out of order are corrupt too, records: 1@100, 2@99 | 3@101
+    RecordingOrderBook small;
+    small.AddOrder({OrderType::BUY, 1, 100, 5});
+    small.AddOrder({OrderType::BUY, 2, 99, 5});
+    small.AddOrder({OrderType::SELL, 3, 101, 5});
+    small.SaveSnapshot(path);
+    std::stringstream bytes;
+    bytes << std::ifstream(path, std::ios::binary).rdbuf();
+    auto load_with = [&](size_t record, size_t offset, uint32_t value) {
+        std::string tampered = bytes.str();
+        std::memcpy(&tampered[sizeof(SnapshotHeader) + record * sizeof(SnapshotOrder) + offset], &value, sizeof(value));
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << tampered;
+        RecordingOrderBook book;
+        book.LoadSnapshot(path);
+        return book.GetBidQuantity() + book.GetAskQuantity();
+    };
+    EXPECT_EQ(load_with(1, offsetof(SnapshotOrder, order_id), 2), 15);  // unchanged
+    EXPECT_THROW(load_with(1, offsetof(SnapshotOrder, order_id), 1), std::runtime_error);
+    EXPECT_THROW(load_with(2, offsetof(SnapshotOrder, price), 100), std::runtime_error);
+    EXPECT_THROW(load_with(1, offsetof(SnapshotOrder, price), 150), std::runtime_error);
+    std::remove(path.c_str());
+    std::vector<SnapshotOrder> sparse_ids = {{7, 100, 1, 0, 0}, {4000000000u, 100, 1, 0, 0}, {9, 100, 1, 0, 0}};
+    EXPECT_FALSE(HasDuplicateOrderIds(sparse_ids));
+    sparse_ids[2].order_id = 4000000000u;
+    EXPECT_TRUE(HasDuplicateOrderIds(sparse_ids));
+}
+
+TEST(ProcessOrdersTestSuit, JournalRecoversBookOnTopOfSnapshot) {
+    /* A book journaled and snapshotted halfway is rebuilt after a crash, torn last record included, by loading the
+     * snapshot and replaying the rest of the journal.
+     */
+    const std::string snapshot_path = testing::TempDir() + "order_book_recovery_snapshot.bin";
+    const std::string journal_path = testing::TempDir() + "order_book_recovery_journal.bin";
+    std::remove(snapshot_path.c_str());
+    std::remove(journal_path.c_str());
+    std::vector<OrderMessage> messages = MixedFlow();
+    size_t half = messages.size() / 2;
+    // the orders get owners and the part after the snapshot mass cancels by owner and by price, which are replayed too
+    for (OrderMessage& message : messages) {
+        if (message.order_message_type == OrderMessageType::ADD_ORDER) {
+            message.order.owner_id = static_cast<OwnerId>(message.order.orderId % 3);
+        }
+    }
+    size_t owner_cancel = half + 100;
+    size_t level_cancel = half + 200;
+    messages.insert(messages.begin() + owner_cancel,
+                    {.order_message_type = OrderMessageType::MASS_CANCEL,
+                     .order = {.order_type = OrderType::BUY, .owner_id = 1}});
+    messages.insert(messages.begin() + level_cancel,
+                    {.order_message_type = OrderMessageType::MASS_CANCEL,
+                     .order = {.order_type = OrderType::SELL, .price = 104}});
+    std::vector<MessageResult> results(messages.size());
+
+    using JournaledBook = BasicOrderBook<JournalSink<TradeRecorder>>;
+    JournaledBook live;
+    {
+        JournalWriter journal(journal_path, {.batch_size = 256, .sync = JournalSync::INTERVAL});
+        live.GetEventSink().Attach(&journal);
+        ApplyJournaled(live, 0, std::span(messages).first(half), std::span(results).first(half));
+        journal.Flush();
+        live.SaveSnapshot(snapshot_path, half);
+        ApplyJournaled(live, half, std::span(messages).subspan(half), std::span(results).subspan(half));
+        journal.Flush();
+        EXPECT_GT(journal.DurableSequence(), half);
+        EXPECT_LE(journal.DurableSequence(), messages.size());
+        live.GetEventSink().Attach(nullptr);
+    }
+
+    uint64_t message_count = 0;
+    uint64_t trade_count = 0;
+    uint64_t record_count = ReadJournal(journal_path, [&](const JournalRecord& record) {
+        (record.type == JournalRecordType::MESSAGE ? message_count : trade_count)++;
+    });
+    EXPECT_EQ(trade_count, live.GetTrades().size());
+    EXPECT_EQ(message_count, std::count_if(messages.begin(), messages.end(), [](const OrderMessage& message) {
+                  return IsJournaled(message.order_message_type);
+              }));
+    std::ofstream(journal_path, std::ios::binary | std::ios::app) << "torn";  // crash in the middle of a write
+
+    JournaledBook recovered;
+    uint64_t next_sequence = RecoverBook(recovered, snapshot_path, journal_path);
+    EXPECT_GT(next_sequence, half);
+    for (OrderType side : {OrderType::BUY, OrderType::SELL}) {
+        std::array<DepthLevel, 32> expected_depth;
+        std::array<DepthLevel, 32> depth;
+        ASSERT_EQ(recovered.GetDepth(side, depth), live.GetDepth(side, expected_depth));
+        EXPECT_EQ(depth, expected_depth);
+    }
+    EXPECT_GT(results[owner_cancel].quantity, 0);
+    EXPECT_GT(results[level_cancel].quantity, 0);
+    for (OwnerId owner : {1, 2}) {
+        EXPECT_EQ(recovered.GetOwnerOrderCount(owner), live.GetOwnerOrderCount(owner));
+    }
+    for (JournaledBook* book : {&live, &recovered}) {
+        book->AddOrder({OrderType::SELL, 5000, 1, 1000, OrderKind::IOC});
+    }
+    EXPECT_EQ(recovered.GetTrades().back(), live.GetTrades().back());
+
+    // the torn record is cut off before the journal is appended to again
+    {
+        JournalWriter journal(journal_path);
+        recovered.GetEventSink().Attach(&journal);
+        OrderMessage cancel{OrderMessageType::CANCEL_ORDER, {OrderType::UNDEFINED, 4999}};
+        MessageResult result;
+        ApplyJournaled(recovered, next_sequence, {&cancel, 1}, {&result, 1});
+    }
+    std::vector<JournalRecord> records;
+    EXPECT_EQ(ReadJournal(journal_path, [&](const JournalRecord& record) { records.push_back(record); }),
+              record_count + 1);
+    EXPECT_EQ(records.back().sequence, next_sequence);
+    EXPECT_EQ(records.back().order_id, 4999);
+    std::remove(snapshot_path.c_str());
+    std::remove(journal_path.c_str());
+}
+
+TEST(ProcessOrdersTestSuit, GeneratedOrderFlow) {
+    /* The generator is deterministic per seed, adds have increasing ids, cancels refer to orders added before and
+     * never twice, and book depth and burstiness shape the flow.
+     */
+    auto generate = [](const OrderFlowConfig& config, size_t count) {
+        OrderFlowGenerator generator(config);
+        std::vector<OrderMessage> messages(count);
+        generator.Next(messages);
+        return messages;
+    };
+    auto same = [](const std::vector<OrderMessage>& a, const std::vector<OrderMessage>& b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const OrderMessage& x, const OrderMessage& y) {
+            return x.order_message_type == y.order_message_type && x.order.orderId == y.order.orderId &&
+                   x.order.order_type == y.order.order_type && x.order.price == y.order.price &&
+                   x.order.quantity == y.order.quantity && x.lower_price == y.lower_price &&
+                   x.upper_price == y.upper_price;
+        });
+    };
+    std::vector<OrderMessage> flow = generate({.seed = 7}, 100000);
+    EXPECT_TRUE(same(flow, generate({.seed = 7}, 100000)));
+    EXPECT_FALSE(same(flow, generate({.seed = 8}, 100000)));
+
+    std::set<uint32_t> added;
+    uint32_t last_id = 0;
+    size_t cancels = 0;
+    for (const OrderMessage& message : flow) {
+        if (message.order_message_type == OrderMessageType::ADD_ORDER) {
+            EXPECT_GT(message.order.orderId, last_id);
+            EXPECT_GE(message.order.quantity, 1);
+            EXPECT_LE(message.order.quantity, 100);
+            last_id = message.order.orderId;
+            added.insert(last_id);
+        } else if (message.order_message_type == OrderMessageType::CANCEL_ORDER) {
+            EXPECT_EQ(added.erase(message.order.orderId), 1);
+            cancels++;
+        } else if (message.order_message_type == OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES) {
+            EXPECT_LE(message.lower_price, message.upper_price);
+        }
+    }
+    EXPECT_NEAR(static_cast<double>(cancels) / flow.size(), 0.15, 0.01);
+
+    OrderFlowGenerator shallow({.cancel_weight = 0.05, .book_depth = 50});
+    for (int i = 0; i < 10000; i++) {
+        shallow.Next();
+        ASSERT_LE(shallow.RestingCount(), 50);
+    }
+
+    auto repeats = [](const std::vector<OrderMessage>& messages) {
+        size_t count = 0;
+        for (size_t i = 1; i < messages.size(); i++) {
+            count += messages[i].order_message_type == messages[i - 1].order_message_type;
+        }
+        return count;
+    };
+    EXPECT_GT(repeats(generate({.burstiness = 0.8}, 10000)), 2 * repeats(generate({}, 10000)));
+}
+
+TEST(ProcessOrdersTestSuit, CsvMessagesRoundTrip) {
+    /* Every message type, with and without the optional Symbol, Order Kind and Owner columns, is read back as it was
+     * written. Lines may end in \r\n, the last one without a newline, and a malformed line is reported, not read as
+     * zeros.
+     */
+    std::vector<OrderMessage> messages = {
+        {.order_message_type = OrderMessageType::ADD_ORDER, .order = {OrderType::BUY, 1, 100, 5}},
+        {.order_message_type = OrderMessageType::ADD_ORDER,
+         .order = {OrderType::SELL, 2, 101, 6, OrderKind::IOC, 7},
+         .symbol_id = 3},
+        {.order_message_type = OrderMessageType::ADD_ORDER,
+         .order = {OrderType::BUY, 3, 0, 8, OrderKind::MARKET},
+         .symbol_id = 65535},
+        {.order_message_type = OrderMessageType::ADD_ORDER, .order = {OrderType::SELL, 4, 102, 9, OrderKind::FOK}},
+        {.order_message_type = OrderMessageType::ADD_ORDER, .order = {OrderType::BUY, 5, 99, 1, OrderKind::LIMIT, 2}},
+        {.order_message_type = OrderMessageType::CANCEL_ORDER, .order = {.orderId = 1}, .symbol_id = 3},
+        {.order_message_type = OrderMessageType::MODIFY_ORDER, .order = {.orderId = 5, .price = 98, .quantity = 4}},
+        {.order_message_type = OrderMessageType::MASS_CANCEL, .order = {.order_type = OrderType::BUY, .owner_id = 2}},
+        {.order_message_type = OrderMessageType::MASS_CANCEL,
+         .order = {.order_type = OrderType::SELL, .price = 104},
+         .symbol_id = 1},
+        {.order_message_type = OrderMessageType::GET_BEST_BID, .order = {}},
+        {.order_message_type = OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES,
+         .order = {},
+         .lower_price = 100,
+         .upper_price = 103}};
+    auto expect_same = [](const OrderMessage& read, const OrderMessage& written) {
+        EXPECT_EQ(read.order_message_type, written.order_message_type);
+        EXPECT_EQ(read.order.order_type, written.order.order_type);
+        EXPECT_EQ(read.order.orderId, written.order.orderId);
+        EXPECT_EQ(read.order.price, written.order.price);
+        EXPECT_EQ(read.order.quantity, written.order.quantity);
+        EXPECT_EQ(read.order.kind, written.order.kind);
+        EXPECT_EQ(read.order.owner_id, written.order.owner_id);
+        EXPECT_EQ(read.symbol_id, written.symbol_id);
+        EXPECT_EQ(read.lower_price, written.lower_price);
+        EXPECT_EQ(read.upper_price, written.upper_price);
+    };
+
+    const std::string path = testing::TempDir() + "order_messages_round_trip.csv";
+    {
+        CsvMessageWriter writer(path);
+        for (const OrderMessage& message : messages) writer.Write(message);
+        writer.Write({.order_message_type = OrderMessageType::UNDEFINED, .order = {}});  // has no line
+        EXPECT_EQ(writer.RecordCount(), messages.size());
+    }
+    {
+        CsvMessageReader reader(path);
+        OrderMessage message;
+        for (const OrderMessage& written : messages) {
+            ASSERT_TRUE(reader.Next(message));
+            expect_same(message, written);
+        }
+        EXPECT_FALSE(reader.Next(message));
+    }
+
+    // \r\n line endings, blank lines and no newline after the last line
+    std::ofstream(path, std::ios::binary | std::ios::trunc)
+        << "Message Type,Order ID,Order Type,Price,Quantity,Lower Price,Upper Price\r\n"
+           "AddOrder,1,buy,100,5,,\r\n\r\nGetAskVolumeBetweenPrices,,,,,99,101\r\nCancelOrder,1,,,,,";
+    {
+        CsvMessageReader reader(path);
+        OrderMessage message;
+        ASSERT_TRUE(reader.Next(message));
+        expect_same(message, messages[0]);
+        ASSERT_TRUE(reader.Skip());
+        ASSERT_TRUE(reader.Next(message));
+        EXPECT_EQ(message.order_message_type, OrderMessageType::CANCEL_ORDER);
+        EXPECT_EQ(message.order.orderId, 1);
+        EXPECT_FALSE(reader.Next(message));
+    }
+
+    for (const char* line : {"AddOrder,x,buy,100,5,,", "AddOrder,1,buy,,5,,", "AddOrder,1,buy,100,5x,,",
+                             "AddOrder,1,buy,100,-5,,", "AddOrder,1,buy,100,99999999999,,", "CancelOrder,,,,,,",
+                             "ModifyOrder,1,,100,,,", "GetAskVolumeBetweenPrices,,,,,99,", "Unknown,1,buy,100,5,,",
+                             "AddOrder,1,buy,100,5,,,70000", "AddOrder,1,buy,100,5,,,0,limit,x"}) {
+        EXPECT_THROW(ParseOrderMessageLine(line), std::invalid_argument) << line;
+    }
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "header\nAddOrder,1,buy,100,5,,\nAddOrder,2,buy,,5,,\n";
+    {
+        CsvMessageReader reader(path);
+        OrderMessage message;
+        ASSERT_TRUE(reader.Next(message));
+        EXPECT_THROW(reader.Next(message), std::invalid_argument);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(ProcessOrdersTestSuit, IngestSequencerMergesSessionsDeterministically) {
+    /* Three sessions publish interleaved parts of one flow concurrently, timestamped with the flow position. The
+     * merged stream is the flow in order with consecutive sequence numbers, and the book matches it like the flow.
+     * A session that only sends heartbeats does not hold the others back.
+     */
+    std::vector<OrderMessage> flow = MixedFlow();
+    constexpr size_t kSessions = 3;
+    IngestSequencer<> sequencer(kSessions + 1, 64);  // small channels, the producers block on them
+    std::vector<std::thread> producers;
+    for (size_t session = 0; session < kSessions; session++) {
+        producers.emplace_back([&, session] {
+            for (size_t i = 0; i < flow.size(); i++) {
+                if (i / 7 % kSessions == session) sequencer.Publish(session, i, flow[i]);
+            }
+            sequencer.Close(session);
+        });
+    }
+    std::atomic<bool> stop_heartbeats{false};
+    producers.emplace_back([&] {
+        for (uint64_t timestamp = 0; !stop_heartbeats.load(); timestamp += 100) {
+            sequencer.Heartbeat(kSessions, std::min<uint64_t>(timestamp, flow.size()));
+            std::this_thread::yield();
+        }
+        sequencer.Close(kSessions);
+    });
+
+    std::vector<OrderMessage> merged;
+    std::array<SequencedMessage, 100> out;
+    while (!sequencer.Done()) {
+        size_t count = sequencer.Poll(out);
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(out[i].sequence, merged.size());
+            merged.push_back(out[i].message);
+        }
+        if (merged.size() == flow.size()) stop_heartbeats = true;
+        if (count == 0) std::this_thread::yield();
+    }
+    for (std::thread& producer : producers) producer.join();
+
+    ASSERT_EQ(merged.size(), flow.size());
+    for (size_t i = 0; i < flow.size(); i++) {
+        ASSERT_EQ(merged[i].order_message_type, flow[i].order_message_type);
+        ASSERT_EQ(merged[i].order.orderId, flow[i].order.orderId);
+    }
+    RecordingOrderBook expected_book;
+    RecordingOrderBook merged_book;
+    std::vector<MessageResult> expected_results(flow.size());
+    std::vector<MessageResult> merged_results(flow.size());
+    expected_book.Apply(flow, expected_results);
+    merged_book.Apply(merged, merged_results);
+    EXPECT_EQ(merged_results, expected_results);
+    EXPECT_EQ(merged_book.GetTrades().size(), expected_book.GetTrades().size());
+}
+
+TEST(ProcessOrdersTestSuit, TopOfBookPublishesConsistentSnapshots) {
+    /* The top of book follows the best levels and keeps the sequence of the message that last changed it. */
+    OrderBook book;
+    const TopOfBookCell& top_of_book = book.GetTopOfBook();
+    EXPECT_EQ(top_of_book.Read().sequence, 0);
+    book.AddOrder({OrderType::BUY, 1, 100, 10});
+    book.AddOrder({OrderType::SELL, 2, 105, 7});
+    book.AddOrder({OrderType::BUY, 3, 90, 5});  // behind the best bid, no publish
+    TopOfBook top = top_of_book.Read();
+    EXPECT_EQ(top.bid_price, 100);
+    EXPECT_EQ(top.bid_quantity, 10);
+    EXPECT_EQ(top.ask_price, 105);
+    EXPECT_EQ(top.ask_quantity, 7);
+    EXPECT_EQ(top.sequence, 2);
+    EXPECT_EQ(top_of_book.PublishCount(), 2);
+
+    std::array<OrderMessage, 2> messages{};
+    messages[0].order_message_type = OrderMessageType::ADD_ORDER;
+    messages[0].order = {OrderType::BUY, 4, 105, 3};  // trades 3 of the best ask
+    messages[1].order_message_type = OrderMessageType::GET_BEST_BID;
+    std::array<MessageResult, 2> results;
+    book.Apply(messages, results);
+    top = top_of_book.Read();
+    EXPECT_EQ(top.ask_quantity, 4);
+    EXPECT_EQ(top.sequence, 4);
+    book.CancelOrderbyId(1);
+    top = top_of_book.Read();
+    EXPECT_EQ(top.bid_price, 90);
+    EXPECT_EQ(top.sequence, 6);
+
+    /* Readers on other threads only ever see whole publishes: the writer keeps price == quantity == sequence on the
+     * bid side, and the sequence never goes back.
+     */
+    OrderBook raced_book;
+    constexpr uint32_t kOrders = 20000;
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    std::atomic<uint64_t> torn{0};
+    for (int reader = 0; reader < 2; reader++) {
+        readers.emplace_back([&] {
+            uint64_t last_sequence = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                TopOfBook snapshot = raced_book.GetTopOfBook().Read();
+                if (snapshot.bid_price != snapshot.sequence || snapshot.bid_quantity != snapshot.sequence ||
+                    snapshot.sequence < last_sequence) {
+                    torn++;
+                }
+                last_sequence = snapshot.sequence;
+            }
+        });
+    }
+    for (uint32_t i = 1; i <= kOrders; i++) {
+        raced_book.AddOrder({OrderType::BUY, i, i, i});
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& reader : readers) reader.join();
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(raced_book.GetTopOfBook().Read().sequence, kOrders);
+}
+
+TEST(ProcessOrdersTestSuit, DepthSnapshotsAnswerLikeTheBook) {
+    /* A published image answers the range and aggregate queries like the book at the time of the publish, and a held
+     * snapshot stays unchanged while the writer publishes new images.
+     */
+    OrderBook book;
+    DepthSnapshotPublisher publisher;
+    EXPECT_EQ(publisher.Acquire()->TotalQuantity(OrderType::BUY), 0);
+    std::vector<OrderMessage> flow = MixedFlow();
+    std::vector<MessageResult> results(flow.size());
+    book.Apply(flow, results);
+    publisher.Publish(book, book.GetMessageSequence());
+
+    DepthSnapshot snapshot = publisher.Acquire();
+    EXPECT_EQ(snapshot->Sequence(), flow.size());
+    EXPECT_EQ(snapshot->TotalQuantity(OrderType::BUY), book.GetBidQuantity());
+    EXPECT_EQ(snapshot->TotalQuantity(OrderType::SELL), book.GetAskQuantity());
+    std::array<DepthLevel, 5> top;
+    size_t count = book.GetDepth(OrderType::SELL, top);
+    ASSERT_GE(snapshot->Levels(OrderType::SELL).size(), count);
+    for (size_t i = 0; i < count; i++) EXPECT_EQ(snapshot->Levels(OrderType::SELL)[i], top[i]);
+    for (uint32_t low = 80; low < 130; low += 3) {
+        for (uint32_t high = low - 5; high < 140; high += 7) {
+            EXPECT_EQ(snapshot->VolumeBetween(OrderType::SELL, low, high), book.GetVolumeBetweenPrices(low, high));
+            EXPECT_EQ(snapshot->VolumeBetween(OrderType::BUY, low, high), book.GetBidVolumeBetweenPrices(low, high));
+        }
+    }
+
+    uint64_t held_bids = snapshot->TotalQuantity(OrderType::BUY);
+    book.AddOrder({OrderType::BUY, 1000000, 1, 500});
+    publisher.Publish(book, book.GetMessageSequence());
+    publisher.Publish(book, book.GetMessageSequence());
+    EXPECT_EQ(snapshot->TotalQuantity(OrderType::BUY), held_bids);
+    EXPECT_EQ(publisher.Acquire()->TotalQuantity(OrderType::BUY), held_bids + 500);
+    EXPECT_EQ(publisher.ImageCount(), 3);  // the held image, the current one and a spare
+    EXPECT_FALSE(publisher.PublishIfRequested(book, 0));
+    publisher.RequestPublish();
+    EXPECT_TRUE(publisher.PublishIfRequested(book, 0));
+
+    /* Readers scan while the writer keeps changing the book and publishing: every image they pin is whole, its total
+     * matches the sum of its levels, and its sequence never goes back.
+     */
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> inconsistent{0};
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 2; reader++) {
+        readers.emplace_back([&] {
+            uint64_t last_sequence = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                DepthSnapshot image = publisher.Acquire();
+                uint64_t sum = 0;
+                for (const DepthLevel& level : image->Levels(OrderType::BUY)) sum += level.quantity;
+                if (sum != image->TotalQuantity(OrderType::BUY) || image->Sequence() < last_sequence) inconsistent++;
+                last_sequence = image->Sequence();
+            }
+        });
+    }
+    for (uint32_t i = 1; i <= 2000; i++) {
+        book.AddOrder({OrderType::BUY, 1000000 + i, 1 + i % 50, i});
+        publisher.Publish(book, book.GetMessageSequence());
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& reader : readers) reader.join();
+    EXPECT_EQ(inconsistent.load(), 0);
+    EXPECT_LE(publisher.ImageCount(), 6);  // the current image, a spare and at most one pinned per reader
+}
+
+template <typename Book>
+void CheckMassCancels() {
+    /* Owners 1 and 2 quote both sides over several levels, anonymous orders rest among them. */
+    auto book = std::make_unique<Book>();
+    uint32_t order_id = 0;
+    for (uint32_t level = 0; level < 5; level++) {
+        for (OwnerId owner : {1, 2, 0}) {
+            book->AddOrder({OrderType::BUY, ++order_id, 100 - level, 10, OrderKind::LIMIT, owner});
+            book->AddOrder({OrderType::SELL, ++order_id, 101 + level, 10, OrderKind::LIMIT, owner});
+        }
+    }
+    EXPECT_EQ(book->GetOwnerOrderCount(1), 10);
+
+    // owner 1 pulls its bids, then everything else: only its own orders go
+    EXPECT_EQ(book->CancelOwnerOrders(1, OrderType::BUY), 5);
+    EXPECT_EQ(book->GetBidQuantity(), 100);
+    EXPECT_EQ(book->GetAskQuantity(), 150);
+    EXPECT_EQ(book->CancelOwnerOrders(1), 5);
+    EXPECT_EQ(book->GetOwnerOrderCount(1), 0);
+    EXPECT_EQ(book->GetAskQuantity(), 100);
+    EXPECT_EQ(book->CancelOwnerOrders(0), 0);  // anonymous orders are not tracked
+
+    // a fill removes the order from its owner list too
+    book->AddOrder({OrderType::BUY, ++order_id, 101, 10});  // takes owner 2's ask at 101
+    EXPECT_EQ(book->GetOwnerOrderCount(2), 9);
+
+    // whole levels at or beyond a price, every owner
+    EXPECT_EQ(book->CancelLevelsFrom(OrderType::BUY, 98), 6);  // 98, 97, 96
+    EXPECT_EQ(book->GetBestBidWithQuantity(), std::make_pair(100u, 20u));
+    EXPECT_EQ(book->GetBidVolumeBetweenPrices(1, 98), 0);
+    EXPECT_EQ(book->GetOwnerOrderCount(2), 6);
+    EXPECT_EQ(book->CancelLevelsFrom(OrderType::SELL, 104), 4);  // 104, 105
+    EXPECT_EQ(book->GetBestAsk(), 101);
+    EXPECT_EQ(book->CancelSide(OrderType::SELL), 5);
+    EXPECT_EQ(book->GetAskQuantity(), 0);
+    EXPECT_EQ(book->GetOwnerOrderCount(2), 2);
+
+    // the released ids and levels are reusable
+    book->AddOrder({OrderType::SELL, ++order_id, 103, 5, OrderKind::LIMIT, 2});
+    book->CancelOrderbyId(order_id - 1);  // already filled, a reject
+    EXPECT_EQ(book->GetOwnerOrderCount(2), 3);
+    EXPECT_EQ(book->CancelOwnerOrders(2), 3);
+    EXPECT_EQ(book->GetBidQuantity(), 20);  // the anonymous bids at 100 and 99
+}
+
+TEST(ProcessOrdersTestSuit, MassCancelByOwnerSideAndPrice) {
+    CheckMassCancels<OrderBook>();
+    CheckMassCancels<BasicOrderBook<NullEventSink, MapBookPolicy>>();
+    CheckMassCancels<BasicOrderBook<NullEventSink, VectorQueueBookPolicy>>();
+
+    /* Every mass cancelled order is reported, and the owners survive a snapshot. */
+    OrderBook book;
+    for (uint32_t i = 1; i <= 6; i++) {
+        book.AddOrder({OrderType::BUY, i, 100 - i % 3, 10, OrderKind::LIMIT, static_cast<OwnerId>(1 + i % 2)});
+    }
+    const std::string path = "mass_cancel_snapshot.bin";
+    book.SaveSnapshot(path);
+    OrderBook restored;
+    restored.LoadSnapshot(path);
+    std::remove(path.c_str());
+    EXPECT_EQ(restored.GetOwnerOrderCount(1), 3);
+    EXPECT_EQ(restored.CancelOwnerOrders(2), 3);
+    EXPECT_EQ(restored.GetBidQuantity(), 30);
+
+    book.GetEventSink().Drain([](const BookEvent&) {});
+    EXPECT_EQ(book.CancelSide(OrderType::BUY), 6);
+    size_t cancels = 0;
+    book.GetEventSink().Drain([&](const BookEvent& event) { cancels += event.type == BookEventType::CANCEL; });
+    EXPECT_EQ(cancels, 6);
+    EXPECT_EQ(book.GetTopOfBook().Read().bid_price, 0);
+}
+
+TEST(ProcessOrdersTestSuit, OrderQueueErasesWithStaleHeadLinks) {
+    /*
+     *  Taking the head leaves the backward link of the new head stale. Erase the head, the tail and middle orders in
+     *  every order afterwards, the queue and the order halves in the pool must stay consistent.
+     */
+    OrderPool pool;
+    OrderQueue queue;
+    std::vector<OrderHandle> handles;
+    for (uint32_t id = 1; id <= 5; id++) {
+        handles.push_back(pool.Allocate({OrderType::SELL, id, 100 + id, 10 * id, OrderKind::LIMIT, 3}));
+        queue.PushBack(pool, handles.back());
+    }
+    auto ids = [&] {
+        std::vector<uint32_t> result;
+        queue.ForEach(pool, [&](OrderHandle handle) { result.push_back(pool[handle].order_id); });
+        return result;
+    };
+    queue.Erase(pool, handles[0]);  // head, 2 keeps a stale prev
+    queue.Erase(pool, handles[2]);  // middle, relinks 2 and 4
+    EXPECT_EQ(ids(), (std::vector<uint32_t>{2, 4, 5}));
+    queue.Erase(pool, handles[4]);  // tail
+    queue.Erase(pool, handles[1]);  // head again
+    EXPECT_EQ(ids(), (std::vector<uint32_t>{4}));
+    EXPECT_EQ(queue.front(), queue.tail);
+    queue.Erase(pool, handles[3]);  // head and tail
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.tail, kNullOrderHandle);
+    EXPECT_EQ(queue.count, 0);
+
+    // the erased node keeps its order in both halves
+    EXPECT_EQ(pool[handles[3]].side, OrderType::SELL);
+    EXPECT_EQ(pool[handles[3]].order_id, 4);
+    EXPECT_EQ(pool.Cold(handles[3]).price, 104);
+    EXPECT_EQ(pool[handles[3]].quantity, 40);
+    EXPECT_EQ(pool[handles[3]].owner_id, 3);
+}
@@ -1,26 +1,40 @@
-#include <boost/lockfree/spsc_queue.hpp>
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <string>
-#include <thread>
-#include <vector>
 
 #include "dataset_process.hpp"
-#include "order.hpp"
-#include "order_book.hpp"
-#include "order_utilities.hpp"
+#include "latency_stats.hpp"
 
-int main() {
-    read_in_is_done = false;  // flag for consumer_thread to keep running
-    std::thread producer_thread{LoadOrdersFromCSV};
-    std::thread consumer_thread{ProcessOrderMessages};
-    producer_thread.join();
-    consumer_thread.join();
+/*
+ * Usage: OrderBook_run [dataset.csv [sessions] | dataset.bin [shards]]
+ * A .bin dataset (see OrderBook_csv_to_binary) is replayed from a memory mapping on this thread, a .csv dataset is
+ * parsed by a loader thread and processed on this thread. The book's execution reports are drained between packets.
+ * With a shard count the .bin dataset is replayed on the multi instrument engine, one book per symbol. With a session
+ * count the .csv dataset is fed by that many concurrent session threads, merged back in order by the ingest sequencer.
+ */
+int main(int argc, char* argv[]) {
+    std::string filename = "../example_order_dataset/example_dataset.csv";
+    if (argc > 1) {
+        filename = argv[1];
+    }
 
-    std::cout << "Processing finished, trades recorded: " << order_book.GetTrades().size() << std::endl;
-    std::cout << "Returned ask volume: " << debug_dummy_volume_ask << std::endl;
-    std::cout << "Returned bid volume: " << debug_dummy_volume_bid << std::endl;
+    ReplaySession session;
+    if (argc > 2 && filename.ends_with(".bin")) {
+        session.ReplayThroughEngine(filename, std::stoul(argv[2]));
+    } else if (argc > 2) {
+        session.ReplayFromSessions(filename, std::stoul(argv[2]));
+    } else {
+        session.ReplayDataset(filename);
+    }
+    const ReplaySummary& summary = session.Summary();
+    if (!summary.error.empty()) {
+        std::cout << summary.error << std::endl;
+    }
+
+    std::cout << "Processing finished, trades reported: " << summary.trade_count << std::endl;
+    std::cout << "Execution reports dropped: " << summary.dropped_reports << std::endl;
+    std::cout << "Returned ask volume: " << summary.ask_volume << std::endl;
+    std::cout << "Returned bid volume: " << summary.bid_volume << std::endl;
+    LATENCY_STATS(DumpLatencyStats(std::cout));
 
     return 0;
 }
@@ -0,0 +1,38 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("File open failed " + path);
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error("File stat failed " + path);
+    }
+    size_ = file_stat.st_size;
+    if (size_ > 0) {
+        mapping_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);  // the mapping keeps the file referenced
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::runtime_error("File mmap failed " + path);
+    }
+    if (mapping_ != nullptr) {
+        madvise(mapping_, size_, MADV_SEQUENTIAL);  // files are read front to back, let the kernel read ahead
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, size_);
+    }
+}
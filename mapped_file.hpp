@@ -0,0 +1,29 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+ * Read-only memory mapping of a whole file, unmapped on destruction. Throws std::runtime_error if the file cannot be
+ * opened or mapped.
+ */
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return static_cast<const char*>(mapping_); }
+    size_t size() const { return size_; }
+    std::string_view view() const { return {data(), size_}; }
+
+   private:
+    void* mapping_{nullptr};
+    size_t size_{};
+};
+
+#endif  // MAPPED_FILE_HPP
@@ -0,0 +1,31 @@
+#ifndef BOOK_POLICY_HPP
+#define BOOK_POLICY_HPP
+
+#include "level.hpp"
+#include "map_price_levels.hpp"
+#include "order_id_index.hpp"
+#include "order_pool.hpp"
+#include "price_ladder.hpp"
+
+/*
+ * Data structure policies of the BasicOrderBook, chosen at compile time:
+ *   PriceLevels  the levels of one side, PriceLadder or MapPriceLevels (a template over the side Compare and the level)
+ *   Queue        the FIFO of orders of one level, OrderQueue or VectorOrderQueue
+ *   IdIndex      order id -> pool handle, OrderIdIndex or HashOrderIdIndex
+ */
+template <template <typename Compare, typename LevelT> class PriceLevels, typename Queue, typename IdIndex>
+struct BookPolicy {
+    using Level = BasicLevel<Queue>;
+    template <typename Compare>
+    using Levels = PriceLevels<Compare, Level>;
+    using OrderIdIndex = IdIndex;
+};
+
+// Tick indexed ladder, intrusive queues and the paged id index.
+using DefaultBookPolicy = BookPolicy<PriceLadder, OrderQueue, OrderIdIndex>;
+// The Version 2 layout: std::map of levels and a hash map of the ids, with the pooled intrusive queues.
+using MapBookPolicy = BookPolicy<MapPriceLevels, OrderQueue, HashOrderIdIndex>;
+// Default layout with vector queues.
+using VectorQueueBookPolicy = BookPolicy<PriceLadder, VectorOrderQueue, OrderIdIndex>;
+
+#endif  // BOOK_POLICY_HPP
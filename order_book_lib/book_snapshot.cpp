@@ -0,0 +1,86 @@
+#include "book_snapshot.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+bool WriteAll(int fd, const void* buffer, size_t size) {
+    const char* data = static_cast<const char*>(buffer);
+    while (size > 0) {
+        ssize_t count = write(fd, data, size);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+}  // namespace
+
+void WriteSnapshotFile(const std::string& path, const SnapshotHeader& header,
+                       std::span<const SnapshotOrder> records) {
+    std::string temporary_path = path + ".tmp";
+    int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Snapshot file open failed " + temporary_path);
+    }
+    // the data must be on disk before the rename makes it the snapshot
+    bool ok = WriteAll(fd, &header, sizeof(header)) && WriteAll(fd, records.data(), records.size_bytes()) &&
+              fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok) {
+        unlink(temporary_path.c_str());
+        throw std::runtime_error("Snapshot write failed " + temporary_path);
+    }
+    std::filesystem::rename(temporary_path, path);
+
+    // and the rename itself, an entry of the directory
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    int directory_fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+    ok = directory_fd >= 0 && fsync(directory_fd) == 0;
+    if (directory_fd >= 0) {
+        close(directory_fd);
+    }
+    if (!ok) {
+        throw std::runtime_error("Snapshot sync failed " + path);
+    }
+}
+
+bool HasDuplicateOrderIds(std::span<const SnapshotOrder> records) {
+    if (records.empty()) {
+        return false;
+    }
+    auto [min, max] = std::minmax_element(records.begin(), records.end(), [](const auto& a, const auto& b) {
+        return a.order_id < b.order_id;
+    });
+    uint32_t first_id = min->order_id;
+    uint64_t span = uint64_t{max->order_id} - first_id + 1;
+    if (span <= 64 * records.size()) {
+        // live ids are usually a dense window: one bit per id of the window, at most 8 bytes per record
+        std::vector<uint64_t> seen((span + 63) / 64);
+        for (const SnapshotOrder& record : records) {
+            uint64_t bit = record.order_id - first_id;
+            uint64_t mask = uint64_t{1} << (bit & 63);
+            if (seen[bit >> 6] & mask) {
+                return true;
+            }
+            seen[bit >> 6] |= mask;
+        }
+        return false;
+    }
+    std::vector<uint32_t> order_ids;
+    order_ids.reserve(records.size());
+    for (const SnapshotOrder& record : records) order_ids.push_back(record.order_id);
+    std::sort(order_ids.begin(), order_ids.end());
+    return std::adjacent_find(order_ids.begin(), order_ids.end()) != order_ids.end();
+}
@@ -0,0 +1,54 @@
+#ifndef BOOK_SNAPSHOT_HPP
+#define BOOK_SNAPSHOT_HPP
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "order.hpp"
+
+/*
+ * Binary snapshot of the resting orders of a book, written by BasicOrderBook::SaveSnapshot().
+ * A file is a SnapshotHeader followed by order_count SnapshotOrder records: the bids, best level first, then the asks,
+ * and within a level the orders in queue order, so restoring them in file order rebuilds every queue with its time
+ * priority. The id index and the level totals are derived from the records. Every field is little-endian.
+ */
+
+static_assert(std::endian::native == std::endian::little, "book snapshots are written in native byte order");
+
+inline constexpr char kSnapshotMagic[8] = {'O', 'B', 'S', 'N', 'A', 'P', '\0', '\0'};
+inline constexpr uint32_t kSnapshotVersion = 2;  // 2: owner_id
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;       // sizeof(SnapshotOrder) of the writer, checked by the reader
+    uint64_t sequence;          // caller defined position of the snapshot in the input, e.g. the journal sequence
+    uint64_t bid_count;         // bid records, the asks follow
+    uint64_t order_count;       // records after the header
+    uint32_t order_id_tracker;  // highest order id seen, new orders must be above it
+    uint32_t reserved;
+};
+
+struct SnapshotOrder {
+    uint32_t order_id;
+    uint32_t price;
+    uint32_t quantity;
+    OwnerId owner_id;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 48);
+static_assert(sizeof(SnapshotOrder) == 16);
+
+/*
+ * Write header and records to path.tmp, fsync it, rename it over path and fsync the directory, so that after a crash or
+ * a power loss path holds either the previous snapshot or the complete new one. Throws std::runtime_error on failure.
+ */
+void WriteSnapshotFile(const std::string& path, const SnapshotHeader& header, std::span<const SnapshotOrder> records);
+
+// True if an order id appears in more than one record.
+bool HasDuplicateOrderIds(std::span<const SnapshotOrder> records);
+
+#endif  // BOOK_SNAPSHOT_HPP
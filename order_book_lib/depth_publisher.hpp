@@ -0,0 +1,140 @@
+#ifndef DEPTH_PUBLISHER_HPP
+#define DEPTH_PUBLISHER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "event_sink.hpp"
+#include "level.hpp"
+#include "order.hpp"
+
+// New state of one level of one side, level.quantity is zero when the level was removed.
+struct DepthUpdate {
+    OrderType side{};
+    DepthLevel level;
+
+    bool operator==(const DepthUpdate& other) const = default;
+};
+
+/*
+ * Incremental depth feed. Collects the level changes of a book and Publish() emits one update per level that changed
+ * since the previous publish, with its latest state: any number of changes to a level within a batch coalesce into a
+ * single update. Levels are emitted in the order they first changed, bids before asks.
+ */
+class DepthPublisher {
+   public:
+    void OnLevelChange(const LevelChangeEvent& event) {
+        (event.side == OrderType::BUY ? bids_ : asks_).Update({event.price, event.quantity, event.order_count});
+    }
+
+    // Call emit(const DepthUpdate&) for every changed level and start a new batch. Returns the number of updates.
+    template <typename F>
+    size_t Publish(F&& emit) {
+        size_t published = bids_.Drain(OrderType::BUY, emit);
+        return published + asks_.Drain(OrderType::SELL, emit);
+    }
+
+    size_t PendingCount() const { return bids_.Size() + asks_.Size(); }
+
+   private:
+    /*
+     * Latest state of the changed levels of one side: an open addressing table keyed by price, in which an entry
+     * belongs to the current batch when its generation matches. Starting a new batch bumps the generation instead of
+     * clearing the table, the storage only grows when a batch touches more levels than ever before.
+     */
+    class ChangedLevels {
+       public:
+        ChangedLevels() : slots_(kInitialSlots) { order_.reserve(kInitialSlots / 2); }
+
+        size_t Size() const { return order_.size(); }
+
+        void Update(const DepthLevel& level) {
+            if (2 * (order_.size() + 1) > slots_.size()) {
+                Grow();
+            }
+            size_t index = Probe(level.price);
+            if (slots_[index].generation != generation_) {
+                slots_[index].generation = generation_;
+                order_.push_back(static_cast<uint32_t>(index));
+            }
+            slots_[index].level = level;
+        }
+
+        template <typename F>
+        size_t Drain(OrderType side, F& emit) {
+            for (uint32_t index : order_) {
+                emit(DepthUpdate{side, slots_[index].level});
+            }
+            size_t drained = order_.size();
+            order_.clear();
+            if (++generation_ == 0) {  // wrapped, forget the stale generations
+                for (Slot& slot : slots_) slot.generation = 0;
+                generation_ = 1;
+            }
+            return drained;
+        }
+
+       private:
+        static constexpr size_t kInitialSlots = 64;
+
+        struct Slot {
+            uint32_t generation{0};
+            DepthLevel level;
+        };
+
+        // Slot of price in the current batch, or the free slot where it goes.
+        size_t Probe(uint32_t price) const {
+            size_t mask = slots_.size() - 1;
+            size_t index = (price * 0x9E3779B1u) & mask;  // odd multiplier: neighbouring ticks never collide
+            while (slots_[index].generation == generation_ && slots_[index].level.price != price) {
+                index = (index + 1) & mask;
+            }
+            return index;
+        }
+
+        void Grow() {
+            std::vector<Slot> old_slots(2 * slots_.size());
+            old_slots.swap(slots_);
+            std::vector<uint32_t> old_order;
+            old_order.swap(order_);
+            order_.reserve(slots_.size() / 2);
+            for (uint32_t old_index : old_order) {
+                size_t index = Probe(old_slots[old_index].level.price);
+                slots_[index] = old_slots[old_index];
+                order_.push_back(static_cast<uint32_t>(index));
+            }
+        }
+
+        std::vector<Slot> slots_;      // power of two size, at most half full
+        std::vector<uint32_t> order_;  // slots changed in the current batch, in order of first change
+        uint32_t generation_{1};
+    };
+
+    ChangedLevels bids_;
+    ChangedLevels asks_;
+};
+
+/*
+ * Event sink decorator: forwards every event to Inner and feeds the level changes to a DepthPublisher, so a book
+ * keeps an incremental depth feed next to its usual execution reports.
+ */
+template <EventSink Inner = NullEventSink>
+class DepthTrackingSink : public Inner {
+   public:
+    template <typename... Args>
+    explicit DepthTrackingSink(Args&&... args) : Inner(std::forward<Args>(args)...) {}
+
+    void OnLevelChange(const LevelChangeEvent& event) {
+        Inner::OnLevelChange(event);
+        depth_.OnLevelChange(event);
+    }
+
+    DepthPublisher& Depth() { return depth_; }
+
+   private:
+    DepthPublisher depth_;
+};
+
+#endif  // DEPTH_PUBLISHER_HPP
@@ -0,0 +1,205 @@
+#ifndef DEPTH_SNAPSHOT_HPP
+#define DEPTH_SNAPSHOT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "level.hpp"
+#include "order.hpp"
+#include "spsc_channel.hpp"
+
+/*
+ * Immutable depth image of a book: every level of both sides, best first, in contiguous arrays with the cumulative
+ * quantity of the levels before each one, so a range or aggregate query is two binary searches and a subtraction.
+ */
+class DepthImage {
+   public:
+    // Sequence number of the last book message applied before the capture.
+    uint64_t Sequence() const { return sequence_; }
+
+    // Levels of one side, best first: bids by decreasing price, asks by increasing price.
+    std::span<const DepthLevel> Levels(OrderType side) const { return Of(side).levels; }
+
+    uint64_t TotalQuantity(OrderType side) const { return Of(side).cumulative.back(); }
+
+    // Quantity of one side between low and high, both inclusive, like OrderBook::GetVolumeBetweenPrices.
+    uint64_t VolumeBetween(OrderType side, uint32_t low, uint32_t high) const {
+        if (low > high) return 0;
+        const SideImage& levels = Of(side);
+        auto price_of = [&](size_t index) { return levels.levels[index].price; };
+        size_t first;
+        size_t last;  // one past the last level in the range
+        if (side == OrderType::BUY) {
+            first = PartitionPoint(levels.levels.size(), [&](size_t i) { return price_of(i) > high; });
+            last = PartitionPoint(levels.levels.size(), [&](size_t i) { return price_of(i) >= low; });
+        } else {
+            first = PartitionPoint(levels.levels.size(), [&](size_t i) { return price_of(i) < low; });
+            last = PartitionPoint(levels.levels.size(), [&](size_t i) { return price_of(i) <= high; });
+        }
+        return first < last ? levels.cumulative[last] - levels.cumulative[first] : 0;
+    }
+
+    // Replace the image with the current depth of book. Reuses the storage of the previous capture.
+    template <typename Book>
+    void Capture(Book& book, uint64_t sequence) {
+        sequence_ = sequence;
+        bids_.Capture(book, OrderType::BUY);
+        asks_.Capture(book, OrderType::SELL);
+    }
+
+   private:
+    struct SideImage {
+        std::vector<DepthLevel> levels;
+        std::vector<uint64_t> cumulative{0};  // cumulative[i]: quantity of levels[0, i)
+
+        template <typename Book>
+        void Capture(Book& book, OrderType side) {
+            levels.resize(std::max<size_t>(levels.capacity(), 64));
+            size_t count;
+            while ((count = book.GetDepth(side, levels)) == levels.size()) {
+                levels.resize(2 * levels.size());  // the side may have more levels, copy again
+            }
+            levels.resize(count);
+            cumulative.resize(count + 1);
+            for (size_t i = 0; i < count; i++) {
+                cumulative[i + 1] = cumulative[i] + levels[i].quantity;
+            }
+        }
+    };
+
+    // First index in [0, size) for which below(index) is false, below must be true then false.
+    template <typename Below>
+    static size_t PartitionPoint(size_t size, Below below) {
+        size_t first = 0;
+        while (size > 0) {
+            size_t half = size / 2;
+            if (below(first + half)) {
+                first += half + 1;
+                size -= half + 1;
+            } else {
+                size = half;
+            }
+        }
+        return first;
+    }
+
+    const SideImage& Of(OrderType side) const { return side == OrderType::BUY ? bids_ : asks_; }
+
+    uint64_t sequence_{0};
+    SideImage bids_;
+    SideImage asks_;
+
+    friend class DepthSnapshot;
+    friend class DepthSnapshotPublisher;
+    alignas(kCacheLineSize) mutable std::atomic<uint32_t> readers_{0};  // snapshots holding the image
+};
+
+// Read access to a published DepthImage, which stays unchanged and alive while the snapshot is held.
+class DepthSnapshot {
+   public:
+    DepthSnapshot() = default;
+    DepthSnapshot(DepthSnapshot&& other) noexcept : image_(std::exchange(other.image_, nullptr)) {}
+    DepthSnapshot& operator=(DepthSnapshot&& other) noexcept {
+        std::swap(image_, other.image_);
+        return *this;
+    }
+    ~DepthSnapshot() {
+        if (image_ != nullptr) {
+            image_->readers_.fetch_sub(1, std::memory_order_release);  // the reads happen before a reuse
+        }
+    }
+
+    const DepthImage& operator*() const { return *image_; }
+    const DepthImage* operator->() const { return image_; }
+
+   private:
+    friend class DepthSnapshotPublisher;
+    explicit DepthSnapshot(const DepthImage* image) : image_(image) {}
+
+    const DepthImage* image_{nullptr};
+};
+
+/*
+ * Publishes depth images of a book from the matching thread to any number of reader threads, RCU style. The writer
+ * captures the book into an image no reader holds and swaps it in as the current one with a single pointer store.
+ * Readers pin the current image with a reference count and run any number of queries on it, as long as they like,
+ * without ever blocking the writer: an image still pinned is simply not reused, and when every spare image is pinned
+ * the writer adds one. The pool only grows while readers hold on to old images.
+ * Pinning is a count increment and a check that the image is still current, retried only when a publish happened in
+ * between. The counts and the current pointer are sequentially consistent, so either the writer sees a pin or the
+ * reader sees that its image was replaced, never neither.
+ * The publisher must outlive the snapshots.
+ */
+class DepthSnapshotPublisher {
+   public:
+    DepthSnapshotPublisher() {
+        images_.push_back(std::make_unique<DepthImage>());  // empty image, current until the first publish
+        current_.store(images_.back().get());
+    }
+
+    DepthSnapshotPublisher(const DepthSnapshotPublisher&) = delete;
+    DepthSnapshotPublisher& operator=(const DepthSnapshotPublisher&) = delete;
+
+    // Writer: capture the depth of book, tagged with sequence, and make it the current image.
+    template <typename Book>
+    void Publish(Book& book, uint64_t sequence) {
+        publish_requested_.store(false, std::memory_order_relaxed);  // a request from now on gets the next publish
+        DepthImage& image = SpareImage();
+        image.Capture(book, sequence);
+        current_.store(&image, std::memory_order_seq_cst);
+    }
+
+    // Writer: Publish() if a reader asked for it since the last publish. A relaxed load when nobody did, so the
+    // matching thread can call it between every packet.
+    template <typename Book>
+    bool PublishIfRequested(Book& book, uint64_t sequence) {
+        if (!publish_requested_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        Publish(book, sequence);
+        return true;
+    }
+
+    // Writer: images allocated so far.
+    size_t ImageCount() const { return images_.size(); }
+
+    // Reader: pin the current image.
+    DepthSnapshot Acquire() const {
+        while (true) {
+            DepthImage* image = current_.load(std::memory_order_seq_cst);
+            image->readers_.fetch_add(1, std::memory_order_seq_cst);
+            if (current_.load(std::memory_order_seq_cst) == image) {
+                return DepthSnapshot(image);
+            }
+            image->readers_.fetch_sub(1, std::memory_order_relaxed);  // replaced meanwhile, nothing was read
+        }
+    }
+
+    // Reader: ask the writer for a fresh image at its next PublishIfRequested().
+    void RequestPublish() { publish_requested_.store(true, std::memory_order_relaxed); }
+
+   private:
+    // An image that is neither current nor pinned, added if there is none.
+    DepthImage& SpareImage() {
+        DepthImage* current = current_.load(std::memory_order_relaxed);
+        for (auto& image : images_) {
+            if (image.get() != current && image->readers_.load(std::memory_order_seq_cst) == 0) {
+                return *image;
+            }
+        }
+        images_.push_back(std::make_unique<DepthImage>());
+        return *images_.back();
+    }
+
+    std::vector<std::unique_ptr<DepthImage>> images_;  // writer only
+    alignas(kCacheLineSize) std::atomic<DepthImage*> current_;
+    alignas(kCacheLineSize) std::atomic<bool> publish_requested_{false};
+};
+
+#endif  // DEPTH_SNAPSHOT_HPP
@@ -0,0 +1,189 @@
+#ifndef EVENT_SINK_HPP
+#define EVENT_SINK_HPP
+
+#include <atomic>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "order.hpp"
+#include "trade.hpp"
+
+// Preprocessor macro definitions
+#ifdef ENABLE_DEBUG_PRINTS
+#define DEBUG_PRINT(x) std::cout << x << std::endl;
+#else
+#define DEBUG_PRINT(x) \
+    do {               \
+    } while (0)
+#endif
+
+/*
+ * Execution reports of the OrderBook. The book calls its event sink (a template parameter, resolved at compile time)
+ * for every fill, cancel, reject and price level quantity change.
+ */
+
+struct TradeEvent {
+    uint32_t buy_order_id{};
+    uint32_t sell_order_id{};
+    uint32_t price{};
+    uint32_t quantity{};
+};
+
+struct CancelEvent {
+    uint32_t order_id{};
+    uint32_t quantity{};  // remaining quantity taken off the book
+};
+
+struct RejectEvent {
+    uint32_t order_id{};
+    MessageStatus reason{};
+};
+
+struct LevelChangeEvent {
+    OrderType side{};
+    uint32_t price{};
+    uint32_t quantity{};     // new total quantity of the level, zero when the level is gone
+    uint32_t order_count{};  // orders resting at the level
+};
+
+template <typename Sink>
+concept EventSink = requires(Sink& sink) {
+    sink.OnTrade(TradeEvent{});
+    sink.OnCancel(CancelEvent{});
+    sink.OnReject(RejectEvent{});
+    sink.OnLevelChange(LevelChangeEvent{});
+};
+
+/*
+ * Discards every event, for benchmarks and books whose output is not needed.
+ */
+struct NullEventSink {
+    void OnTrade(const TradeEvent&) {}
+    void OnCancel(const CancelEvent&) {}
+    void OnReject(const RejectEvent&) {}
+    void OnLevelChange(const LevelChangeEvent&) {}
+};
+
+/*
+ * Counts the trades and drops everything else.
+ */
+class TradeCounter {
+   public:
+    void OnTrade(const TradeEvent&) { trade_count_++; }
+    void OnCancel(const CancelEvent&) {}
+    void OnReject(const RejectEvent&) {}
+    void OnLevelChange(const LevelChangeEvent&) {}
+
+    uint64_t TradeCount() const { return trade_count_; }
+
+   private:
+    uint64_t trade_count_{0};
+};
+
+/*
+ * Records every trade in a vector with a wall clock timestamp, used for testing. Opt-in: the vector grows without
+ * bound and the clock is read for every fill.
+ */
+class TradeRecorder {
+   public:
+    void OnTrade(const TradeEvent& event) {
+        trade trade = {event.buy_order_id, event.sell_order_id, static_cast<double>(event.price), event.quantity,
+                       std::chrono::system_clock::now()};
+        trades_.push_back(trade);
+        DEBUG_PRINT("Trade executed: BuyOrderID: " << trade.buy_order_id << " with SellOrderID: "
+                                                   << trade.sell_order_id << " at price " << trade.price
+                                                   << " for quantity " << trade.quantity << std::endl);
+    }
+    void OnCancel(const CancelEvent&) {}
+    void OnReject(const RejectEvent&) {}
+    void OnLevelChange(const LevelChangeEvent&) {}
+
+    std::vector<trade>& GetTrades() { return trades_; }
+
+   private:
+    std::vector<trade> trades_;
+};
+
+enum class BookEventType : uint8_t { TRADE, CANCEL, REJECT, LEVEL_CHANGE };
+
+// One entry of the RingBufferEventSink, the fields used depend on the type.
+struct BookEvent {
+    BookEventType type{};
+    OrderType side{};          // LEVEL_CHANGE
+    MessageStatus reason{};    // REJECT
+    uint32_t order_id{};       // TRADE: buy order id, CANCEL and REJECT: order id
+    uint32_t sell_order_id{};  // TRADE
+    uint32_t price{};          // TRADE and LEVEL_CHANGE
+    uint32_t quantity{};       // TRADE: traded, CANCEL: cancelled, LEVEL_CHANGE: level total
+    uint32_t order_count{};    // LEVEL_CHANGE: orders resting at the level
+};
+
+inline BookEvent ToBookEvent(const TradeEvent& event) {
+    return {.type = BookEventType::TRADE,
+            .order_id = event.buy_order_id,
+            .sell_order_id = event.sell_order_id,
+            .price = event.price,
+            .quantity = event.quantity};
+}
+inline BookEvent ToBookEvent(const CancelEvent& event) {
+    return {.type = BookEventType::CANCEL, .order_id = event.order_id, .quantity = event.quantity};
+}
+inline BookEvent ToBookEvent(const RejectEvent& event) {
+    return {.type = BookEventType::REJECT, .reason = event.reason, .order_id = event.order_id};
+}
+inline BookEvent ToBookEvent(const LevelChangeEvent& event) {
+    return {.type = BookEventType::LEVEL_CHANGE,
+            .side = event.side,
+            .price = event.price,
+            .quantity = event.quantity,
+            .order_count = event.order_count};
+}
+
+/*
+ * Default sink: a fixed capacity single producer single consumer ring that the matching thread writes and a consumer
+ * thread drains. The ring is allocated once at construction, pushing never allocates nor blocks: when the consumer
+ * falls behind and the ring is full, the event is dropped and counted.
+ */
+class RingBufferEventSink {
+   public:
+    static constexpr size_t kDefaultCapacity = size_t{1} << 16;
+
+    explicit RingBufferEventSink(size_t capacity = kDefaultCapacity) : events_(capacity) {}
+
+    void OnTrade(const TradeEvent& event) { Push(ToBookEvent(event)); }
+    void OnCancel(const CancelEvent& event) { Push(ToBookEvent(event)); }
+    void OnReject(const RejectEvent& event) { Push(ToBookEvent(event)); }
+    void OnLevelChange(const LevelChangeEvent& event) { Push(ToBookEvent(event)); }
+
+    // Consumer side: call f for every queued event, returns the number of events consumed.
+    template <typename F>
+    size_t Drain(F&& f) {
+        return events_.consume_all(f);
+    }
+
+    // Events lost because the ring was full.
+    uint64_t DroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+   private:
+    void Push(const BookEvent& event) {
+        if (!events_.push(event)) {
+            // only the producer writes the counter, a relaxed load + store avoids the locked increment
+            dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    boost::lockfree::spsc_queue<BookEvent> events_;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+static_assert(EventSink<NullEventSink>);
+static_assert(EventSink<TradeCounter>);
+static_assert(EventSink<TradeRecorder>);
+static_assert(EventSink<RingBufferEventSink>);
+
+#endif  // EVENT_SINK_HPP
@@ -0,0 +1,45 @@
+#ifndef FENWICK_TREE_HPP
+#define FENWICK_TREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* FenwickTree (binary indexed tree) keeps prefix sums of a value per slot. Updating a slot and summing a range of
+ * slots are both O(log N), used to answer depth volume queries over price ticks without visiting every level.
+ */
+class FenwickTree {
+   public:
+    explicit FenwickTree(size_t size = 0) : tree_(size + 1, 0) {}
+
+    size_t Size() const { return tree_.size() - 1; }
+
+    void Add(size_t index, int64_t delta) {
+        for (size_t i = index + 1; i < tree_.size(); i += i & (~i + 1)) {
+            tree_[i] += delta;
+        }
+    }
+
+    // Sum of the slots [0, index].
+    uint64_t PrefixSum(size_t index) const {
+        int64_t sum = 0;
+        for (size_t i = index + 1; i > 0; i -= i & (~i + 1)) {
+            sum += tree_[i];
+        }
+        return sum;
+    }
+
+    // Sum of the slots [first, last], both inclusive.
+    uint64_t RangeSum(size_t first, size_t last) const {
+        if (first > last) return 0;
+        return PrefixSum(last) - (first == 0 ? 0 : PrefixSum(first - 1));
+    }
+
+    // Resize to size slots, all set to zero.
+    void Reset(size_t size) { tree_.assign(size + 1, 0); }
+
+   private:
+    std::vector<int64_t> tree_;  // 1-based, tree_[i] holds the sum of the (i & -i) slots ending at i
+};
+
+#endif  // FENWICK_TREE_HPP
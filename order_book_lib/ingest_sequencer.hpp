@@ -0,0 +1,145 @@
+#ifndef INGEST_SEQUENCER_HPP
+#define INGEST_SEQUENCER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "order.hpp"
+#include "spsc_channel.hpp"
+
+// Message of a feed session. Within a session the timestamps must not decrease.
+struct IngestMessage {
+    uint64_t timestamp{};   // ordering key of the message, e.g. the gateway receive time
+    bool heartbeat{false};  // carries no message, only tells that the session has nothing before timestamp
+    OrderMessage message;
+};
+
+/*
+ * Merges the messages of several concurrent feed sessions into one totally ordered stream for the matching thread.
+ * Each session has its own producer thread and its own SPSC channel, so producers never contend with each other. The
+ * consumer (the matching thread) polls the merged stream: messages come out in (timestamp, session index) order and
+ * are stamped with consecutive global sequence numbers from 0.
+ * The order only depends on the content of the session streams, not on thread timing, so a replay of the same
+ * sessions gives the same sequence. The price is that a message is only released once every open session has a
+ * message or a heartbeat at or after its timestamp: an idle session must send heartbeats (or close), otherwise it
+ * holds back the others. A full session channel blocks its producer, nothing is dropped.
+ */
+template <typename WaitStrategy = SpinThenYieldWait>
+class IngestSequencer {
+   public:
+    IngestSequencer(size_t session_count, size_t session_capacity) {
+        if (session_count < 1) {
+            throw std::invalid_argument("Ingest sequencer needs at least one session.");
+        }
+        for (size_t i = 0; i < session_count; i++) {
+            sessions_.push_back(std::make_unique<Session>(session_capacity));
+        }
+    }
+
+    IngestSequencer(const IngestSequencer&) = delete;
+    IngestSequencer& operator=(const IngestSequencer&) = delete;
+
+    size_t SessionCount() const { return sessions_.size(); }
+
+    // Producer of session: queue messages, waiting while the session channel is full.
+    void Publish(size_t session, std::span<const IngestMessage> messages) {
+        sessions_[session]->channel.Push(messages);
+    }
+    void Publish(size_t session, uint64_t timestamp, const OrderMessage& message) {
+        sessions_[session]->channel.Push({timestamp, false, message});
+    }
+    // Producer of session: nothing will be published before timestamp, lets the other sessions go on.
+    void Heartbeat(size_t session, uint64_t timestamp) { sessions_[session]->channel.Push({timestamp, true, {}}); }
+    // Producer of session: the session is finished.
+    void Close(size_t session) { sessions_[session]->channel.Close(); }
+
+    // Consumer: write the next messages of the merged stream to out, without waiting. Returns the number written, 0
+    // when a session holds back the next message or every session is done.
+    size_t Poll(std::span<SequencedMessage> out);
+
+    // Consumer: every session is closed and all their messages were polled.
+    bool Done() {
+        for (auto& session : sessions_) {
+            if (Refill(*session)) return false;
+            if (!session->drained) return false;
+        }
+        return true;
+    }
+
+    // Consumer: sequence number of the next polled message.
+    uint64_t NextSequence() const { return next_sequence_; }
+
+   private:
+    static constexpr size_t kSessionBatch = 64;  // messages popped from a session channel at once
+
+    struct Session {
+        explicit Session(size_t capacity) : channel(capacity) {}
+
+        SpscChannel<IngestMessage, WaitStrategy> channel;
+        // Consumer side: messages popped and not merged yet.
+        std::array<IngestMessage, kSessionBatch> pending;
+        size_t head{0};
+        size_t count{0};
+        bool drained{false};  // closed and empty
+    };
+
+    // True if the session has a message to merge, pops the next batch when needed.
+    bool Refill(Session& session);
+
+    std::vector<std::unique_ptr<Session>> sessions_;
+    uint64_t next_sequence_{0};
+};
+
+template <typename WaitStrategy>
+bool IngestSequencer<WaitStrategy>::Refill(Session& session) {
+    if (session.head < session.count) {
+        return true;
+    }
+    if (session.drained) {
+        return false;
+    }
+    bool closed = session.channel.Closed();  // before the pop: every message pushed before Close() is visible
+    session.count = session.channel.TryPop(session.pending);
+    session.head = 0;
+    if (session.count == 0 && closed) {
+        session.drained = true;
+    }
+    return session.count > 0;
+}
+
+/*
+ * K-way merge: the next message is the earliest head of the sessions, the lowest session index on equal timestamps.
+ * It can only be chosen when every session that is not drained has a head, an empty open session could still publish
+ * an earlier message. Heartbeats at the head are consumed without output.
+ */
+template <typename WaitStrategy>
+size_t IngestSequencer<WaitStrategy>::Poll(std::span<SequencedMessage> out) {
+    size_t polled = 0;
+    while (polled < out.size()) {
+        Session* next = nullptr;
+        for (auto& session : sessions_) {
+            if (!Refill(*session)) {
+                if (session->drained) continue;
+                return polled;  // wait for this session
+            }
+            if (next == nullptr || session->pending[session->head].timestamp < next->pending[next->head].timestamp) {
+                next = session.get();
+            }
+        }
+        if (next == nullptr) {
+            break;  // every session is done
+        }
+        const IngestMessage& item = next->pending[next->head++];
+        if (!item.heartbeat) {
+            out[polled++] = {next_sequence_++, item.message};
+        }
+    }
+    return polled;
+}
+
+#endif  // INGEST_SEQUENCER_HPP
@@ -0,0 +1,164 @@
+#include "journal.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <vector>
+
+namespace {
+
+// Longest sleep of an idle writer.
+constexpr std::chrono::microseconds kIdleSleep{50};
+
+}  // namespace
+
+JournalWriter::JournalWriter(const std::string& path, const JournalConfig& config)
+    : config_(config), path_(path), channel_(config.buffer_capacity) {
+    if (config.batch_size < 1) {
+        throw std::invalid_argument("Journal batch size must be more than zero.");
+    }
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Journal open failed " + path);
+    }
+    struct stat file_stat {};
+    if (fstat(fd_, &file_stat) != 0) {
+        close(fd_);
+        throw std::runtime_error("Journal stat failed " + path);
+    }
+    uint64_t size = file_stat.st_size;
+    bool ok = true;
+    if (size < sizeof(JournalHeader)) {
+        // new journal, or a crash before the header was written
+        JournalHeader header{};
+        std::memcpy(header.magic, kJournalMagic, sizeof(header.magic));
+        header.version = kJournalVersion;
+        header.record_size = sizeof(JournalRecord);
+        ok = ftruncate(fd_, 0) == 0 && write(fd_, &header, sizeof(header)) == sizeof(header);
+    } else {
+        JournalHeader header{};
+        int read_fd = open(path.c_str(), O_RDONLY);
+        bool valid = read_fd >= 0 && read(read_fd, &header, sizeof(header)) == sizeof(header) &&
+                     std::memcmp(header.magic, kJournalMagic, sizeof(header.magic)) == 0 &&
+                     header.version == kJournalVersion && header.record_size == sizeof(JournalRecord);
+        if (read_fd >= 0) {
+            close(read_fd);
+        }
+        if (!valid) {
+            close(fd_);
+            throw std::runtime_error("Corrupt journal file " + path);
+        }
+        // cut off a record torn by a crash, appending after it would misalign every following record
+        uint64_t records = (size - sizeof(JournalHeader)) / sizeof(JournalRecord);
+        ok = ftruncate(fd_, sizeof(JournalHeader) + records * sizeof(JournalRecord)) == 0;
+    }
+    if (!ok || (config_.sync != JournalSync::NEVER && !Sync())) {
+        close(fd_);
+        throw std::runtime_error("Journal write failed " + path);
+    }
+    thread_ = std::thread(&JournalWriter::Run, this);
+}
+
+void JournalWriter::Flush() {
+    flush_request_.store(appended_, std::memory_order_release);
+    while (synced_.load(std::memory_order_acquire) < appended_) {
+        if (Failed()) {
+            throw std::runtime_error("Journal write failed " + path_);
+        }
+        std::this_thread::yield();
+    }
+}
+
+void JournalWriter::Close() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    closing_.store(true, std::memory_order_release);
+    thread_.join();
+    close(fd_);
+    fd_ = -1;
+}
+
+/*
+ * Writer thread: collect records until the batch is full, the oldest record waited commit_interval, a Flush() asks
+ * for them or the journal closes, then write them at once. Sync the written records as configured and publish the
+ * durable sequence. After a failed write the records are still taken from the channel, so that the matching thread
+ * never blocks on a dead writer, and dropped.
+ */
+void JournalWriter::Run() {
+    using Clock = std::chrono::steady_clock;
+    std::vector<JournalRecord> batch(config_.batch_size);
+    size_t buffered = 0;
+    uint64_t written_count = 0;
+    uint64_t synced_count = 0;
+    uint64_t written_sequence = 0;  // sequence after the last written record
+    Clock::time_point batch_start = Clock::now();
+    Clock::time_point last_sync = Clock::now();
+
+    while (true) {
+        bool closing = closing_.load(std::memory_order_acquire);  // before the pop: every record is in the channel
+        size_t popped = channel_.TryPop(std::span<JournalRecord>(batch).subspan(buffered));
+        Clock::time_point now = Clock::now();
+        if (buffered == 0 && popped > 0) {
+            batch_start = now;
+        }
+        buffered += popped;
+        bool flush = closing || flush_request_.load(std::memory_order_acquire) > written_count;
+
+        if (buffered == batch.size() ||
+            (buffered > 0 && (flush || now - batch_start >= config_.commit_interval))) {
+            if (!Failed() && !Write({batch.data(), buffered})) {
+                failed_.store(true, std::memory_order_release);
+            }
+            written_count += buffered;
+            written_sequence = batch[buffered - 1].sequence + 1;
+            buffered = 0;
+            written_.store(written_count, std::memory_order_release);
+        }
+
+        if (synced_count < written_count &&
+            (config_.sync != JournalSync::INTERVAL || flush || now - last_sync >= config_.sync_interval)) {
+            if (config_.sync != JournalSync::NEVER && !Failed() && !Sync()) {
+                failed_.store(true, std::memory_order_release);
+            }
+            last_sync = now;
+            synced_count = written_count;
+            if (!Failed()) {
+                durable_sequence_.store(written_sequence, std::memory_order_release);
+            }
+            synced_.store(synced_count, std::memory_order_release);
+        }
+
+        if (popped == 0) {
+            if (closing && buffered == 0 && synced_count == written_count) {
+                return;
+            }
+            std::this_thread::sleep_for(std::min(config_.commit_interval, kIdleSleep));
+        }
+    }
+}
+
+bool JournalWriter::Write(std::span<const JournalRecord> records) {
+    const char* data = reinterpret_cast<const char*>(records.data());
+    size_t remaining = records.size_bytes();
+    while (remaining > 0) {
+        ssize_t count = write(fd_, data, remaining);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += count;
+        remaining -= count;
+    }
+    return true;
+}
+
+bool JournalWriter::Sync() {
+#ifdef __linux__
+    return fdatasync(fd_) == 0;
+#else
+    return fsync(fd_) == 0;
+#endif
+}
@@ -0,0 +1,288 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "event_sink.hpp"
+#include "order.hpp"
+#include "spsc_channel.hpp"
+
+/*
+ * Write-ahead journal of a book: every order message that can change the book (add, cancel, modify, mass cancel) is
+ * appended before it is applied, followed by the trades it caused. A JournalHeader is followed by fixed size
+ * JournalRecords. The messages are written before their outcome is known, a rejected message is rejected again when it
+ * is replayed. Every field is little-endian.
+ */
+
+static_assert(std::endian::native == std::endian::little, "journals are written in native byte order");
+
+inline constexpr char kJournalMagic[8] = {'O', 'B', 'J', 'R', 'N', 'L', '\0', '\0'};
+inline constexpr uint32_t kJournalVersion = 1;
+
+struct JournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;  // sizeof(JournalRecord) of the writer, checked by the reader
+};
+
+enum class JournalRecordType : uint8_t { MESSAGE, TRADE };
+
+struct JournalRecord {
+    uint64_t sequence;  // input sequence of the message, a trade carries the sequence of the message that caused it
+    JournalRecordType type;
+    uint8_t message_type;  // MESSAGE: OrderMessageType
+    uint8_t order_type;    // MESSAGE: OrderType
+    OrderKind order_kind;  // MESSAGE
+    SymbolId symbol_id;
+    OwnerId owner_id;  // MESSAGE
+    uint32_t order_id;  // MESSAGE: order id, TRADE: buy order id
+    uint32_t price;
+    uint32_t quantity;
+    uint32_t sell_order_id;  // TRADE
+};
+
+static_assert(sizeof(JournalHeader) == 16);
+static_assert(sizeof(JournalRecord) == 32);
+
+// Queries do not change the book and are not journaled.
+inline bool IsJournaled(OrderMessageType type) {
+    return type == OrderMessageType::ADD_ORDER || type == OrderMessageType::CANCEL_ORDER ||
+           type == OrderMessageType::MODIFY_ORDER || type == OrderMessageType::MASS_CANCEL;
+}
+
+inline JournalRecord ToJournalRecord(uint64_t sequence, const OrderMessage& message) {
+    JournalRecord record{};
+    record.sequence = sequence;
+    record.type = JournalRecordType::MESSAGE;
+    record.message_type = static_cast<uint8_t>(message.order_message_type);
+    record.order_type = static_cast<uint8_t>(message.order.order_type);
+    record.order_kind = message.order.kind;
+    record.owner_id = message.order.owner_id;
+    record.symbol_id = message.symbol_id;
+    record.order_id = message.order.orderId;
+    record.price = message.order.price;
+    record.quantity = message.order.quantity;
+    return record;
+}
+
+inline JournalRecord ToJournalRecord(uint64_t sequence, SymbolId symbol_id, const TradeEvent& trade) {
+    JournalRecord record{};
+    record.sequence = sequence;
+    record.type = JournalRecordType::TRADE;
+    record.symbol_id = symbol_id;
+    record.order_id = trade.buy_order_id;
+    record.price = trade.price;
+    record.quantity = trade.quantity;
+    record.sell_order_id = trade.sell_order_id;
+    return record;
+}
+
+inline OrderMessage ToOrderMessage(const JournalRecord& record) {
+    OrderMessage message;
+    message.order_message_type = static_cast<OrderMessageType>(record.message_type);
+    message.order = {static_cast<OrderType>(record.order_type), record.order_id, record.price, record.quantity,
+                     record.order_kind, record.owner_id};
+    message.symbol_id = record.symbol_id;
+    return message;
+}
+
+enum class JournalSync {
+    NEVER,        // leave the flushing to the kernel, a crash of the machine loses the last writes
+    EVERY_WRITE,  // fdatasync after every write
+    INTERVAL,     // fdatasync at most every sync_interval
+};
+
+struct JournalConfig {
+    size_t buffer_capacity{size_t{1} << 16};          // records between the matching thread and the writer
+    size_t batch_size{4096};                          // records written at once at most
+    std::chrono::microseconds commit_interval{1000};  // group commit: longest wait of a record for its write
+    JournalSync sync{JournalSync::EVERY_WRITE};
+    std::chrono::microseconds sync_interval{10000};  // JournalSync::INTERVAL
+};
+
+/*
+ * Appends journal records to a file from a dedicated writer thread. The matching thread only copies the records into
+ * a bounded SPSC channel (Append, no system call, blocks only when the writer is buffer_capacity records behind). The
+ * writer collects the records for up to commit_interval or batch_size records, writes them with one write() and syncs
+ * them as configured (group commit). DurableSequence() tells up to which sequence the journal is on disk.
+ * An existing journal is appended to, after cutting off a record torn by a crash.
+ */
+class JournalWriter {
+   public:
+    explicit JournalWriter(const std::string& path, const JournalConfig& config = {});
+    ~JournalWriter() { Close(); }
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    // Matching thread: queue a record.
+    void Append(const JournalRecord& record) {
+        channel_.Push(record);
+        appended_++;
+    }
+
+    // Matching thread: wait until every appended record is written and synced (unless JournalSync::NEVER). Throws if
+    // the writer failed.
+    void Flush();
+
+    // Write the remaining records and stop the writer thread.
+    void Close();
+
+    // Every record with a lower sequence is written (and synced unless JournalSync::NEVER): the sequence after the
+    // last durable record, 0 before the first write. A message can be acknowledged once this is above its sequence.
+    uint64_t DurableSequence() const { return durable_sequence_.load(std::memory_order_acquire); }
+    uint64_t WrittenCount() const { return written_.load(std::memory_order_acquire); }
+    bool Failed() const { return failed_.load(std::memory_order_acquire); }
+
+   private:
+    void Run();
+    bool Write(std::span<const JournalRecord> records);
+    bool Sync();
+
+    JournalConfig config_;
+    std::string path_;
+    int fd_{-1};
+    SpscChannel<JournalRecord> channel_;
+    uint64_t appended_{0};  // matching thread only
+
+    alignas(kCacheLineSize) std::atomic<uint64_t> written_{0};  // records written
+    std::atomic<uint64_t> synced_{0};                           // records synced (written with JournalSync::NEVER)
+    std::atomic<uint64_t> durable_sequence_{0};
+    std::atomic<uint64_t> flush_request_{0};  // records a Flush() waits for
+    std::atomic<bool> failed_{false};
+    std::atomic<bool> closing_{false};
+    std::thread thread_;
+};
+
+/*
+ * Event sink journaling the trades of the book after the message that caused them, and forwarding every event to
+ * Inner. Use ApplyJournaled() to apply messages to the book, it journals them and sets the current sequence. Without
+ * a journal attached (e.g. during recovery) nothing is journaled.
+ */
+template <EventSink Inner = NullEventSink>
+class JournalSink : public Inner {
+   public:
+    template <typename... Args>
+    explicit JournalSink(JournalWriter* journal = nullptr, Args&&... args)
+        : Inner(std::forward<Args>(args)...), journal_(journal) {}
+
+    void OnTrade(const TradeEvent& event) {
+        Inner::OnTrade(event);
+        if (journal_ != nullptr) {
+            journal_->Append(ToJournalRecord(sequence_, symbol_id_, event));
+        }
+    }
+
+    void Attach(JournalWriter* journal) { journal_ = journal; }
+    JournalWriter* Journal() { return journal_; }
+
+    // Message being applied, stamped on its trades.
+    void SetCurrent(uint64_t sequence, SymbolId symbol_id) {
+        sequence_ = sequence;
+        symbol_id_ = symbol_id;
+    }
+
+   private:
+    JournalWriter* journal_;
+    uint64_t sequence_{0};
+    SymbolId symbol_id_{0};
+};
+
+/*
+ * Apply messages numbered first_sequence, first_sequence + 1, ... to a book with a JournalSink: each book changing
+ * message is journaled before it is applied, its trades right after it. Returns the number of messages applied.
+ */
+template <typename Book>
+size_t ApplyJournaled(Book& book, uint64_t first_sequence, std::span<const OrderMessage> messages,
+                      std::span<MessageResult> results) {
+    size_t count = std::min(messages.size(), results.size());
+    auto& sink = book.GetEventSink();
+    JournalWriter* journal = sink.Journal();
+    for (size_t i = 0; i < count; i++) {
+        uint64_t sequence = first_sequence + i;
+        if (journal != nullptr && IsJournaled(messages[i].order_message_type)) {
+            journal->Append(ToJournalRecord(sequence, messages[i]));
+        }
+        sink.SetCurrent(sequence, messages[i].symbol_id);
+        book.Apply(messages.subspan(i, 1), results.subspan(i, 1));
+    }
+    return count;
+}
+
+/*
+ * Call f(record) for every complete record of the journal at path, in file order. A record cut short by a crash at
+ * the end of the file is ignored. Returns the number of records read, 0 if the file does not exist.
+ */
+template <typename F>
+uint64_t ReadJournal(const std::string& path, F&& f) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+    JournalHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return 0;  // crashed before the header was written
+    }
+    if (std::memcmp(header.magic, kJournalMagic, sizeof(header.magic)) != 0 || header.version != kJournalVersion ||
+        header.record_size != sizeof(JournalRecord)) {
+        throw std::runtime_error("Corrupt journal file " + path);
+    }
+    std::array<JournalRecord, 4096> records;
+    uint64_t count = 0;
+    while (file) {
+        file.read(reinterpret_cast<char*>(records.data()), sizeof(records));
+        size_t read = static_cast<size_t>(file.gcount()) / sizeof(JournalRecord);
+        for (size_t i = 0; i < read; i++) {
+            f(records[i]);
+        }
+        count += read;
+    }
+    return count;
+}
+
+/*
+ * Rebuild a book after a crash: load the snapshot at snapshot_path, if there is one, then replay the journaled
+ * messages from the snapshot sequence on. The book must be empty and must not journal (no journal attached to its
+ * sink), the trades of the replay are published to the sink again. Returns the sequence of the next message.
+ * The snapshot sequence is the sequence of the first message not in the snapshot, the one to pass to SaveSnapshot
+ * after a JournalWriter::Flush().
+ */
+template <typename Book>
+uint64_t RecoverBook(Book& book, const std::string& snapshot_path, const std::string& journal_path) {
+    uint64_t next_sequence = 0;
+    if (std::filesystem::exists(snapshot_path)) {
+        next_sequence = book.LoadSnapshot(snapshot_path);
+    }
+    std::array<OrderMessage, 128> messages;
+    std::array<MessageResult, 128> results;
+    size_t count = 0;
+    ReadJournal(journal_path, [&](const JournalRecord& record) {
+        if (record.type != JournalRecordType::MESSAGE || record.sequence < next_sequence) {
+            return;
+        }
+        messages[count++] = ToOrderMessage(record);
+        next_sequence = record.sequence + 1;
+        if (count == messages.size()) {
+            book.Apply({messages.data(), count}, {results.data(), count});
+            count = 0;
+        }
+    });
+    book.Apply({messages.data(), count}, {results.data(), count});
+    return next_sequence;
+}
+
+#endif  // JOURNAL_HPP
@@ -0,0 +1,117 @@
+#include "latency_stats.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Recorders of the running threads, and the merged counts of the threads that exited.
+struct LatencyRegistry {
+    std::mutex mutex;
+    std::vector<const LatencyRecorder*> recorders;
+    std::array<LatencyHistogram, LatencyRecorder::kMessageTypeCount> service;
+    std::array<LatencyHistogram, LatencyRecorder::kMessageTypeCount> queue_wait;
+};
+
+LatencyRegistry& Registry() {
+    static LatencyRegistry* registry = new LatencyRegistry();  // never destroyed, threads may exit after main
+    return *registry;
+}
+
+using Histograms = std::array<LatencyHistogram, LatencyRecorder::kMessageTypeCount>;
+
+const char* MessageTypeName(size_t type) {
+    switch (static_cast<OrderMessageType>(type)) {
+        case OrderMessageType::ADD_ORDER:
+            return "AddOrder";
+        case OrderMessageType::CANCEL_ORDER:
+            return "CancelOrder";
+        case OrderMessageType::GET_BEST_BID:
+            return "GetBestBid";
+        case OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES:
+            return "GetAskVolumeBetweenPrices";
+        case OrderMessageType::MODIFY_ORDER:
+            return "ModifyOrder";
+        case OrderMessageType::MASS_CANCEL:
+            return "MassCancel";
+        default:
+            return "Undefined";
+    }
+}
+
+void DumpHistograms(std::ostream& out, const char* metric, const Histograms& histograms) {
+    double ticks_per_ns = TscTicksPerNanosecond();
+    for (size_t type = 0; type < histograms.size(); type++) {
+        const LatencyHistogram& histogram = histograms[type];
+        uint64_t count = histogram.TotalCount();
+        if (count == 0) {
+            continue;
+        }
+        out << std::left << std::setw(12) << metric << std::setw(27) << MessageTypeName(type) << std::right
+            << std::setw(12) << count;
+        for (double quantile : {0.5, 0.99, 0.999, 1.0}) {
+            out << std::setw(10) << static_cast<uint64_t>(histogram.ValueAtQuantile(quantile) / ticks_per_ns);
+        }
+        out << "\n";
+    }
+}
+
+}  // namespace
+
+double TscTicksPerNanosecond() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const double ticks_per_ns = [] {
+        auto start_time = std::chrono::steady_clock::now();
+        uint64_t start_ticks = ReadTsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t ticks = ReadTsc() - start_ticks;
+        auto elapsed = std::chrono::steady_clock::now() - start_time;
+        return static_cast<double>(ticks) / std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }();
+    return ticks_per_ns;
+#else
+    return 1.0;  // ReadTsc() returns nanoseconds
+#endif
+}
+
+LatencyRecorder::LatencyRecorder() {
+    LatencyRegistry& registry = Registry();
+    std::lock_guard lock(registry.mutex);
+    registry.recorders.push_back(this);
+}
+
+LatencyRecorder::~LatencyRecorder() {
+    LatencyRegistry& registry = Registry();
+    std::lock_guard lock(registry.mutex);
+    for (size_t type = 0; type < kMessageTypeCount; type++) {
+        registry.service[type].Add(service_[type]);
+        registry.queue_wait[type].Add(queue_wait_[type]);
+    }
+    std::erase(registry.recorders, this);
+}
+
+void DumpLatencyStats(std::ostream& out) {
+    LatencyRegistry& registry = Registry();
+    // Merged copies, too large for the stack.
+    auto service = std::make_unique<Histograms>();
+    auto queue_wait = std::make_unique<Histograms>();
+    {
+        std::lock_guard lock(registry.mutex);
+        for (size_t type = 0; type < LatencyRecorder::kMessageTypeCount; type++) {
+            (*service)[type].Add(registry.service[type]);
+            (*queue_wait)[type].Add(registry.queue_wait[type]);
+            for (const LatencyRecorder* recorder : registry.recorders) {
+                (*service)[type].Add(recorder->ServiceTime(static_cast<OrderMessageType>(type)));
+                (*queue_wait)[type].Add(recorder->QueueWait(static_cast<OrderMessageType>(type)));
+            }
+        }
+    }
+    out << std::left << std::setw(12) << "latency ns" << std::setw(27) << "message type" << std::right << std::setw(12)
+        << "count" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10)
+        << "max" << "\n";
+    DumpHistograms(out, "service", *service);
+    DumpHistograms(out, "queue wait", *queue_wait);
+}
@@ -0,0 +1,156 @@
+#ifndef LATENCY_STATS_HPP
+#define LATENCY_STATS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "order.hpp"
+
+/*
+ * Latency instrumentation of the processing loop: per OrderMessageType histograms of the service time (OrderBook::Apply
+ * of one message) and of the queue wait (from parsing to processing). Built with ENABLE_LATENCY_STATS only, otherwise
+ * every LATENCY_STATS(...) statement compiles to nothing.
+ */
+#ifdef ENABLE_LATENCY_STATS
+#define LATENCY_STATS(x) x
+#else
+#define LATENCY_STATS(x) \
+    do {                 \
+    } while (0)
+#endif
+
+// Timestamp in TSC ticks (steady clock nanoseconds where there is no TSC), a few cycles and no system call.
+inline uint64_t ReadTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// TSC ticks per nanosecond, calibrated against the steady clock on first use.
+double TscTicksPerNanosecond();
+
+/*
+ * HDR style log-linear histogram of 64-bit values: the values below 64 have a bucket each, above that every power of
+ * two range is split into 32 buckets, so a recorded value is reported within ~3%. Written by a single thread without
+ * locked instructions, the counters can be read at any time by another thread.
+ */
+class LatencyHistogram {
+   public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr size_t kSubBucketCount = size_t{1} << kSubBucketBits;
+    static constexpr size_t kBucketCount = 2 * kSubBucketCount + (63 - kSubBucketBits) * kSubBucketCount;
+
+    static size_t BucketOf(uint64_t value) {
+        if (value < 2 * kSubBucketCount) {
+            return value;
+        }
+        int exponent = std::bit_width(value) - 1;
+        int shift = exponent - kSubBucketBits;
+        return 2 * kSubBucketCount + (exponent - kSubBucketBits - 1) * kSubBucketCount +
+               ((value >> shift) - kSubBucketCount);
+    }
+
+    // Highest value counted in bucket.
+    static uint64_t BucketLimit(size_t bucket) {
+        if (bucket < 2 * kSubBucketCount) {
+            return bucket;
+        }
+        size_t exponent = (bucket - 2 * kSubBucketCount) / kSubBucketCount + kSubBucketBits + 1;
+        size_t shift = exponent - kSubBucketBits;
+        uint64_t sub_bucket = (bucket - 2 * kSubBucketCount) % kSubBucketCount + kSubBucketCount;
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+    // Owner thread only.
+    void Record(uint64_t value) {
+        std::atomic<uint64_t>& count = counts_[BucketOf(value)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Add the counts of other to this histogram, owner thread only.
+    void Add(const LatencyHistogram& other) {
+        for (size_t bucket = 0; bucket < kBucketCount; bucket++) {
+            std::atomic<uint64_t>& count = counts_[bucket];
+            count.store(count.load(std::memory_order_relaxed) + other.BucketCount(bucket), std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t BucketCount(size_t bucket) const { return counts_[bucket].load(std::memory_order_relaxed); }
+
+    uint64_t TotalCount() const {
+        uint64_t count = 0;
+        for (const auto& bucket_count : counts_) count += bucket_count.load(std::memory_order_relaxed);
+        return count;
+    }
+
+    // Highest value of the bucket holding the given fraction of the count, 0 when empty.
+    uint64_t ValueAtQuantile(double quantile) const {
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile * TotalCount() + 0.5));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < kBucketCount; bucket++) {
+            seen += BucketCount(bucket);
+            if (seen >= rank) {
+                return BucketLimit(bucket);
+            }
+        }
+        return 0;
+    }
+
+   private:
+    std::array<std::atomic<uint64_t>, kBucketCount> counts_{};
+};
+
+/*
+ * Histograms of one thread. Each thread that records gets its own, registered for DumpLatencyStats().
+ */
+class LatencyRecorder {
+   public:
+    static constexpr size_t kMessageTypeCount = static_cast<size_t>(OrderMessageType::MASS_CANCEL) + 1;
+
+    LatencyRecorder();
+    ~LatencyRecorder();
+
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    void RecordServiceTime(OrderMessageType type, uint64_t ticks) { service_[Index(type)].Record(ticks); }
+    void RecordQueueWait(OrderMessageType type, uint64_t ticks) { queue_wait_[Index(type)].Record(ticks); }
+
+    const LatencyHistogram& ServiceTime(OrderMessageType type) const { return service_[Index(type)]; }
+    const LatencyHistogram& QueueWait(OrderMessageType type) const { return queue_wait_[Index(type)]; }
+
+   private:
+    static size_t Index(OrderMessageType type) {
+        size_t index = static_cast<size_t>(type);
+        return index < kMessageTypeCount ? index : 0;
+    }
+
+    std::array<LatencyHistogram, kMessageTypeCount> service_;
+    std::array<LatencyHistogram, kMessageTypeCount> queue_wait_;
+};
+
+// The recorder of the calling thread, created on first use.
+inline LatencyRecorder& ThreadLatencyRecorder() {
+    thread_local std::unique_ptr<LatencyRecorder> recorder = std::make_unique<LatencyRecorder>();
+    return *recorder;
+}
+
+// Print count and percentiles in nanoseconds per message type, merged over every thread (including finished ones).
+// Can be called at any time from any thread.
+void DumpLatencyStats(std::ostream& out);
+
+#endif  // LATENCY_STATS_HPP
@@ -1,20 +1,32 @@
 #ifndef LEVEL_HPP
 #define LEVEL_HPP
 
-#include <list>
+#include <cstdint>
 
-#include "order.hpp"
+#include "order_pool.hpp"
 
 /* Llevel is an object for a price level of an instrument. It encapsulates every standing order for the instrument at
- * this price point. Internally it holds a bidirectional linked list of order_list object.
+ * this price point. Internally it holds a FIFO of the orders (Queue, a book policy), the order nodes live in the
+ * OrderBook's pool.
  */
 
-struct Order;
-
-struct Level {
+template <typename Queue>
+struct BasicLevel {
     uint32_t quantity{};
     uint32_t price{};
-    std::list<Order> orders_list{};
+    Queue orders_list{};
+};
+
+// Level of the default book, with the intrusive order queue.
+using Level = BasicLevel<OrderQueue>;
+
+// One price level of a depth snapshot or update, a zero quantity level has no orders left.
+struct DepthLevel {
+    uint32_t price{};
+    uint32_t quantity{};
+    uint32_t order_count{};
+
+    bool operator==(const DepthLevel& other) const = default;
 };
 
 #endif  // LEVEL_HPP
@@ -0,0 +1,110 @@
+#ifndef MAP_PRICE_LEVELS_HPP
+#define MAP_PRICE_LEVELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <type_traits>
+
+#include "level.hpp"
+
+/* MapPriceLevels holds the price levels of one side in a std::map, the Version 2 design: no price window to recenter
+ * and O(log L) lookups in the number of levels. An alternative price level policy to the PriceLadder with the same
+ * interface. The volume of a price range walks the levels of the range.
+ * Level references stay valid until the level is removed.
+ */
+template <typename Compare = std::less<>, typename LevelT = Level>
+class MapPriceLevels {
+    using Map = std::map<uint32_t, LevelT, Compare>;
+    static constexpr bool kDescending = std::is_same_v<Compare, std::greater<>>;
+
+   public:
+    // Iterates over the levels instead of the map entries.
+    class iterator {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = LevelT;
+        using difference_type = std::ptrdiff_t;
+        using pointer = LevelT*;
+        using reference = LevelT&;
+
+        iterator() = default;
+        explicit iterator(typename Map::iterator it) : it_(it) {}
+
+        LevelT& operator*() const { return it_->second; }
+        LevelT* operator->() const { return &it_->second; }
+        iterator& operator++() {
+            ++it_;
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        bool operator==(const iterator& other) const { return it_ == other.it_; }
+
+       private:
+        typename Map::iterator it_;
+    };
+
+    bool empty() const { return levels_.empty(); }
+
+    // Iterate over the levels, best price first.
+    iterator begin() { return iterator(levels_.begin()); }
+    iterator end() { return iterator(levels_.end()); }
+
+    // First level that is not better than price.
+    iterator lower_bound(uint32_t price) { return iterator(levels_.lower_bound(price)); }
+
+    // Best (first) level, must not be empty.
+    LevelT& Best() { return levels_.begin()->second; }
+
+    // Level at price, nullptr if there are no orders at that price.
+    LevelT* Find(uint32_t price) {
+        auto it = levels_.find(price);
+        return it == levels_.end() ? nullptr : &it->second;
+    }
+
+    LevelT& FindOrCreate(uint32_t price) {
+        auto [it, inserted] = levels_.try_emplace(price);
+        if (inserted) {
+            it->second.price = price;
+        }
+        return it->second;
+    }
+
+    void AddQuantity(LevelT& level, uint32_t quantity) {
+        level.quantity += quantity;
+        total_quantity_ += quantity;
+    }
+
+    void ReduceQuantity(LevelT& level, uint32_t quantity) {
+        level.quantity -= quantity;
+        total_quantity_ -= quantity;
+    }
+
+    // Quantity resting between the prices low and high, both inclusive.
+    uint64_t VolumeBetween(uint32_t low, uint32_t high) const {
+        if (low > high) return 0;
+        uint64_t volume = 0;
+        for (auto it = levels_.lower_bound(kDescending ? high : low); it != levels_.end(); ++it) {
+            if (kDescending ? it->first < low : it->first > high) break;
+            volume += it->second.quantity;
+        }
+        return volume;
+    }
+
+    uint64_t TotalQuantity() const { return total_quantity_; }
+
+    // Release the level at price, it must not hold any orders.
+    void Remove(uint32_t price) { levels_.erase(price); }
+
+   private:
+    Map levels_;
+    uint64_t total_quantity_{0};
+};
+
+#endif  // MAP_PRICE_LEVELS_HPP
@@ -0,0 +1,337 @@
+#ifndef MATCHING_ENGINE_HPP
+#define MATCHING_ENGINE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "event_sink.hpp"
+#include "order.hpp"
+#include "order_book.hpp"
+
+struct SequencedResult {
+    uint64_t sequence{};
+    SymbolId symbol_id{};
+    OrderMessageType message_type{};
+    MessageResult result;
+};
+
+// Execution report of a book, passed to the consumer ahead of the result of the message that caused it.
+struct SequencedReport {
+    uint64_t sequence{};
+    SymbolId symbol_id{};
+    BookEvent event;
+};
+
+// Consumer callback that drops the execution reports.
+struct IgnoreReports {
+    void operator()(const SequencedReport&) const {}
+};
+
+struct MatchingEngineConfig {
+    size_t shard_count{1};         // matching threads
+    size_t queue_capacity{4096};   // entries per shard queue, in each direction
+    bool pin_threads{true};        // pin shard i to cpu first_cpu + i
+    size_t first_cpu{0};
+    bool execution_reports{true};  // stream the execution reports of the books with the results
+    BookSizing book_sizing{};      // initial sizes of every book, small ones for many quiet instruments
+};
+
+/*
+ * Event sink of the books of the engine: passes every event on to Sink and, when enabled, keeps the events of the
+ * message being applied so that its shard can stream them ahead of the result.
+ */
+template <EventSink Sink>
+class ShardEventSink : public Sink {
+   public:
+    void OnTrade(const TradeEvent& event) {
+        Sink::OnTrade(event);
+        Keep(ToBookEvent(event));
+    }
+    void OnCancel(const CancelEvent& event) {
+        Sink::OnCancel(event);
+        Keep(ToBookEvent(event));
+    }
+    void OnReject(const RejectEvent& event) {
+        Sink::OnReject(event);
+        Keep(ToBookEvent(event));
+    }
+    void OnLevelChange(const LevelChangeEvent& event) {
+        Sink::OnLevelChange(event);
+        Keep(ToBookEvent(event));
+    }
+
+    void KeepReports(bool keep) { keep_ = keep; }
+    std::vector<BookEvent>& Reports() { return reports_; }
+
+   private:
+    void Keep(const BookEvent& event) {
+        if (keep_) reports_.push_back(event);
+    }
+
+    bool keep_{false};
+    std::vector<BookEvent> reports_;  // events of the current message, reused
+};
+
+/*
+ * Books of many instruments matched on shard_count threads. The book of a symbol is owned by the shard
+ * symbol % shard_count and only ever touched by that shard's thread, so matching takes no locks. Messages go to the
+ * shards through one SPSC queue each, the results come back through one SPSC queue per shard and Poll() merges them
+ * into a single stream in submission order. The execution reports of a message (fills, cancels, rejects and level
+ * changes of its book) travel through the same queue just ahead of its result, so they are merged in the same order.
+ * Submitting and polling are each single threaded: one producer thread calls TrySubmit()/Submit(), one consumer
+ * thread (possibly the same one) calls Poll()/Flush(). The books are created on first use by their shard thread.
+ */
+template <EventSink Sink = NullEventSink>
+class BasicMatchingEngine {
+   public:
+    using Book = BasicOrderBook<ShardEventSink<Sink>>;
+
+    explicit BasicMatchingEngine(const MatchingEngineConfig& config = {});
+    ~BasicMatchingEngine() { Stop(); }
+
+    BasicMatchingEngine(const BasicMatchingEngine&) = delete;
+    BasicMatchingEngine& operator=(const BasicMatchingEngine&) = delete;
+
+    size_t ShardCount() const { return shards_.size(); }
+    size_t ShardOf(SymbolId symbol_id) const { return symbol_id % shards_.size(); }
+    uint64_t SubmittedCount() const { return submitted_.load(std::memory_order_acquire); }
+
+    // Producer: queue a message for its shard, false if the shard queue is full.
+    bool TrySubmit(const OrderMessage& message);
+
+    // Producer: queue a message, while the shard queue is full pass the ready results to on_result and reports to
+    // on_report. For a thread that both submits and polls.
+    template <typename F, typename R = IgnoreReports>
+    void Submit(const OrderMessage& message, F&& on_result, R&& on_report = R{}) {
+        while (!TrySubmit(message)) {
+            if (Poll(on_result, on_report) == 0) std::this_thread::yield();
+        }
+    }
+
+    // Consumer: pass every result that is ready, in submission order, to on_result, each preceded by the execution
+    // reports of its message, in the order the book made them, to on_report. Returns the number of results.
+    template <typename F, typename R = IgnoreReports>
+    size_t Poll(F&& on_result, R&& on_report = R{});
+
+    // Consumer: wait for the results of every submitted message.
+    template <typename F, typename R = IgnoreReports>
+    void Flush(F&& on_result, R&& on_report = R{}) {
+        while (next_result_ < SubmittedCount()) {
+            if (Poll(on_result, on_report) == 0) std::this_thread::yield();
+        }
+    }
+
+    // Discard the outstanding results and join the shard threads.
+    void Stop();
+
+    // Book of symbol_id, nullptr if it got no message yet. Only while no message is in flight, e.g. after Flush().
+    Book* FindBook(SymbolId symbol_id);
+
+    // Call f(symbol_id, book) for every book. Only while no message is in flight.
+    template <typename F>
+    void ForEachBook(F&& f);
+
+   private:
+    static constexpr size_t kShardBatch = 64;  // messages popped from a shard queue at once
+
+    // Entry of a shard result queue: one execution report of a message, or its result, which comes last.
+    struct ShardOutput {
+        SequencedResult result;  // sequence, symbol and message type, and the result when !is_report
+        BookEvent report;
+        bool is_report{false};
+    };
+
+    struct Shard {
+        explicit Shard(size_t capacity) : input(capacity), output(capacity) {}
+
+        boost::lockfree::spsc_queue<SequencedMessage> input;
+        boost::lockfree::spsc_queue<ShardOutput> output;
+        std::vector<std::unique_ptr<Book>> books;  // symbol_id / shard count -> book
+        std::thread thread;
+    };
+
+    void RunShard(Shard& shard, size_t cpu);
+    Book& BookOf(Shard& shard, SymbolId symbol_id);
+    static void PushOutput(Shard& shard, const ShardOutput& output);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<uint64_t> submitted_{0};  // sequence of the next message, written by the producer
+    uint64_t next_result_{0};             // sequence of the next result, read and written by the consumer
+    std::atomic<bool> stop_{false};
+    bool stopped_{false};
+    bool execution_reports_;
+    BookSizing book_sizing_;
+};
+
+using MatchingEngine = BasicMatchingEngine<>;
+
+inline void PinCurrentThread(size_t cpu) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);  // best effort, the thread runs unpinned on failure
+#endif
+}
+
+template <EventSink Sink>
+BasicMatchingEngine<Sink>::BasicMatchingEngine(const MatchingEngineConfig& config)
+    : execution_reports_(config.execution_reports), book_sizing_(config.book_sizing) {
+    if (config.shard_count < 1) {
+        throw std::invalid_argument("Matching engine needs at least one shard.");
+    }
+    if (config.queue_capacity < 1) {
+        throw std::invalid_argument("Shard queue capacity must be more than zero.");
+    }
+    size_t cpu_count = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < config.shard_count; i++) {
+        shards_.push_back(std::make_unique<Shard>(config.queue_capacity));
+    }
+    for (size_t i = 0; i < config.shard_count; i++) {
+        size_t cpu = config.pin_threads ? (config.first_cpu + i) % cpu_count : SIZE_MAX;
+        shards_[i]->thread = std::thread(&BasicMatchingEngine::RunShard, this, std::ref(*shards_[i]), cpu);
+    }
+}
+
+template <EventSink Sink>
+bool BasicMatchingEngine<Sink>::TrySubmit(const OrderMessage& message) {
+    uint64_t sequence = submitted_.load(std::memory_order_relaxed);
+    if (!shards_[ShardOf(message.symbol_id)]->input.push({sequence, message})) {
+        return false;
+    }
+    submitted_.store(sequence + 1, std::memory_order_release);
+    return true;
+}
+
+/*
+ * Each shard returns its results in sequence order, so the next result of the stream is at the front of one of the
+ * shard queues, behind the reports of its message. Take entries from a shard as long as they belong to the next
+ * sequence, and move on.
+ */
+template <EventSink Sink>
+template <typename F, typename R>
+size_t BasicMatchingEngine<Sink>::Poll(F&& on_result, R&& on_report) {
+    size_t polled = 0;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (auto& shard : shards_) {
+            while (shard->output.read_available() > 0 && shard->output.front().result.sequence == next_result_) {
+                const ShardOutput& output = shard->output.front();
+                if (output.is_report) {
+                    on_report(SequencedReport{output.result.sequence, output.result.symbol_id, output.report});
+                } else {
+                    on_result(output.result);
+                    next_result_++;
+                    polled++;
+                }
+                shard->output.pop();
+                progress = true;
+            }
+        }
+    }
+    return polled;
+}
+
+template <EventSink Sink>
+void BasicMatchingEngine<Sink>::Stop() {
+    if (stopped_) {
+        return;
+    }
+    Flush([](const SequencedResult&) {});  // a shard blocked on a full result queue would never see the stop flag
+    stop_.store(true, std::memory_order_release);
+    for (auto& shard : shards_) {
+        shard->thread.join();
+    }
+    stopped_ = true;
+}
+
+/*
+ * Shard thread: pop messages in batches, apply each to the book of its symbol and queue its reports and result. A full
+ * result queue blocks the shard until the consumer polls, nothing is dropped.
+ */
+template <EventSink Sink>
+void BasicMatchingEngine<Sink>::RunShard(Shard& shard, size_t cpu) {
+    if (cpu != SIZE_MAX) {
+        PinCurrentThread(cpu);
+    }
+    std::array<SequencedMessage, kShardBatch> batch;
+    while (true) {
+        size_t count = shard.input.pop(batch.data(), batch.size());
+        if (count == 0) {
+            if (stop_.load(std::memory_order_acquire) && shard.input.read_available() == 0) {
+                return;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            const OrderMessage& message = batch[i].message;
+            ShardOutput output{{batch[i].sequence, message.symbol_id, message.order_message_type, {}}, {}, false};
+            Book& book = BookOf(shard, message.symbol_id);
+            book.Apply({&message, 1}, {&output.result.result, 1});
+            std::vector<BookEvent>& reports = book.GetEventSink().Reports();
+            for (const BookEvent& report : reports) {
+                PushOutput(shard, {output.result, report, true});
+            }
+            reports.clear();
+            PushOutput(shard, output);
+        }
+    }
+}
+
+template <EventSink Sink>
+typename BasicMatchingEngine<Sink>::Book& BasicMatchingEngine<Sink>::BookOf(Shard& shard, SymbolId symbol_id) {
+    size_t slot = symbol_id / shards_.size();
+    if (slot >= shard.books.size()) {
+        shard.books.resize(slot + 1);
+    }
+    if (!shard.books[slot]) {
+        shard.books[slot] = std::make_unique<Book>(book_sizing_);  // allocated by the shard thread, local to its node
+        shard.books[slot]->GetEventSink().KeepReports(execution_reports_);
+    }
+    return *shard.books[slot];
+}
+
+template <EventSink Sink>
+void BasicMatchingEngine<Sink>::PushOutput(Shard& shard, const ShardOutput& output) {
+    while (!shard.output.push(output)) {
+        std::this_thread::yield();
+    }
+}
+
+template <EventSink Sink>
+typename BasicMatchingEngine<Sink>::Book* BasicMatchingEngine<Sink>::FindBook(SymbolId symbol_id) {
+    Shard& shard = *shards_[ShardOf(symbol_id)];
+    size_t slot = symbol_id / shards_.size();
+    return slot < shard.books.size() ? shard.books[slot].get() : nullptr;
+}
+
+template <EventSink Sink>
+template <typename F>
+void BasicMatchingEngine<Sink>::ForEachBook(F&& f) {
+    for (size_t shard = 0; shard < shards_.size(); shard++) {
+        for (size_t slot = 0; slot < shards_[shard]->books.size(); slot++) {
+            if (shards_[shard]->books[slot]) {
+                f(static_cast<SymbolId>(slot * shards_.size() + shard), *shards_[shard]->books[slot]);
+            }
+        }
+    }
+}
+
+#endif  // MATCHING_ENGINE_HPP
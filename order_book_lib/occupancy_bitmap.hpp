@@ -0,0 +1,111 @@
+#ifndef OCCUPANCY_BITMAP_HPP
+#define OCCUPANCY_BITMAP_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* OccupancyBitmap is a hierarchical bitset used to find set bits quickly. Layer 0 holds one bit per slot, every upper
+ * layer holds one bit per 64-bit word of the layer below, set when that word is not zero. Finding the next or previous
+ * set bit is therefore a few word scans (one per layer) instead of a linear scan over all slots.
+ */
+class OccupancyBitmap {
+   public:
+    static constexpr size_t npos = SIZE_MAX;
+
+    explicit OccupancyBitmap(size_t size = 0) { Resize(size); }
+
+    // Resize to hold size bits, all bits are cleared.
+    void Resize(size_t size) {
+        size_ = size;
+        layers_.clear();
+        size_t words = std::max<size_t>(1, (size + 63) / 64);
+        while (true) {
+            layers_.emplace_back(words, 0);
+            if (words == 1) break;
+            words = (words + 63) / 64;
+        }
+    }
+
+    size_t Size() const { return size_; }
+    bool Empty() const { return layers_.back()[0] == 0; }
+    bool Test(size_t i) const { return (layers_[0][i >> 6] >> (i & 63)) & 1; }
+
+    void Set(size_t i) {
+        for (auto& layer : layers_) {
+            uint64_t& word = layer[i >> 6];
+            bool was_empty = word == 0;
+            word |= uint64_t{1} << (i & 63);
+            if (!was_empty) break;  // upper layers already flag this word
+            i >>= 6;
+        }
+    }
+
+    void Clear(size_t i) {
+        for (auto& layer : layers_) {
+            uint64_t& word = layer[i >> 6];
+            word &= ~(uint64_t{1} << (i & 63));
+            if (word != 0) break;  // word still has bits, upper layers stay set
+            i >>= 6;
+        }
+    }
+
+    size_t FindFirst() const { return FindNext(0); }
+    size_t FindLast() const { return size_ == 0 ? npos : FindPrev(size_ - 1); }
+
+    // Index of the first set bit at or after pos, npos if there is none.
+    size_t FindNext(size_t pos) const {
+        if (pos >= size_) return npos;
+        size_t layer = 0;
+        while (true) {
+            size_t word = pos >> 6;
+            if (word >= layers_[layer].size()) return npos;
+            uint64_t masked = layers_[layer][word] & (~uint64_t{0} << (pos & 63));
+            if (masked != 0) {
+                pos = (word << 6) | std::countr_zero(masked);
+                break;
+            }
+            if (layer + 1 == layers_.size()) return npos;
+            pos = word + 1;
+            layer++;
+        }
+        // Walk back down, always taking the lowest set bit of the flagged word.
+        while (layer > 0) {
+            layer--;
+            pos = (pos << 6) | std::countr_zero(layers_[layer][pos]);
+        }
+        return pos;
+    }
+
+    // Index of the last set bit at or before pos, npos if there is none.
+    size_t FindPrev(size_t pos) const {
+        if (size_ == 0) return npos;
+        if (pos >= size_) pos = size_ - 1;
+        size_t layer = 0;
+        while (true) {
+            size_t word = pos >> 6;
+            uint64_t masked = layers_[layer][word] & (~uint64_t{0} >> (63 - (pos & 63)));
+            if (masked != 0) {
+                pos = (word << 6) | (63 - std::countl_zero(masked));
+                break;
+            }
+            if (word == 0 || layer + 1 == layers_.size()) return npos;
+            pos = word - 1;
+            layer++;
+        }
+        // Walk back down, always taking the highest set bit of the flagged word.
+        while (layer > 0) {
+            layer--;
+            pos = (pos << 6) | (63 - std::countl_zero(layers_[layer][pos]));
+        }
+        return pos;
+    }
+
+   private:
+    size_t size_{};
+    std::vector<std::vector<uint64_t>> layers_;  // layers_[0] is one bit per slot, back() is a single summary word
+};
+
+#endif  // OCCUPANCY_BITMAP_HPP
@@ -3,27 +3,46 @@
 
 #include <cstdint>  // uint32 type
 
-#include "level.hpp"
-
-enum class OrderType {
+enum class OrderType : uint8_t {
     UNDEFINED,
     BUY,
     SELL,
 };
 
-// forward declaration of level for parentLevel*
-struct Level;
+// How an order executes. Only LIMIT orders rest in the book, the others trade what they can on arrival and the
+// remainder is cancelled.
+enum class OrderKind : uint8_t {
+    LIMIT,
+    MARKET,  // trades at any price, the price is ignored
+    IOC,     // immediate or cancel: trades up to its limit price
+    FOK,     // fill or kill: trades its whole quantity up to its limit price, or nothing
+};
+
+// Owner of an order: the trader or session that sent it, for mass cancels. 0: no owner.
+using OwnerId = uint16_t;
 
 struct Order {
     OrderType order_type{OrderType::UNDEFINED};
     uint32_t orderId{};
     uint32_t price{};
     uint32_t quantity{};
-    Level *parent_level{nullptr};
-    std::list<Order>::iterator listPosition;
+    OrderKind kind{OrderKind::LIMIT};
+    OwnerId owner_id{0};
 };
 
-enum class OrderMessageType { UNDEFINED, ADD_ORDER, CANCEL_ORDER, GET_BEST_BID, GET_ASK_VOLUME_BETWEEN_PRICES };
+// Instrument of an order message, each symbol has its own book.
+using SymbolId = uint16_t;
+
+enum class OrderMessageType {
+    UNDEFINED,
+    ADD_ORDER,
+    CANCEL_ORDER,
+    GET_BEST_BID,
+    GET_ASK_VOLUME_BETWEEN_PRICES,
+    MODIFY_ORDER,  // new price and quantity of a resting order, order.orderId, order.price and order.quantity
+    MASS_CANCEL,   // the orders of order.owner_id on side order.order_type (UNDEFINED: both sides), or with owner 0
+                   // the order.order_type levels at order.price and beyond it. Result quantity: orders cancelled
+};
 
 // To handle ExampleDataset.csv lines
 struct OrderMessage {
@@ -32,6 +51,35 @@ struct OrderMessage {
     // Add fields for GetBestBid and GetAskVolumeBetweenPrices
     int lower_price{0};  // For GetAskVolumeBetweenPrices
     int upper_price{0};  // For GetAskVolumeBetweenPrices
+    SymbolId symbol_id{0};
+#ifdef ENABLE_LATENCY_STATS
+    uint64_t receive_tsc{0};  // ReadTsc() when the message entered the feed, for the queue wait statistics
+#endif
+};
+
+// Order message numbered in a total order: the submission order of the engine, or the order of the ingest sequencer.
+struct SequencedMessage {
+    uint64_t sequence{};
+    OrderMessage message;
+};
+
+// Outcome of one order message applied by OrderBook::Apply().
+enum class MessageStatus {
+    OK,
+    IGNORED,           // undefined message or order type
+    INVALID_QUANTITY,  // AddOrder or ModifyOrder would throw: quantity must be more than zero
+    INVALID_ORDER_ID,  // AddOrder would throw: order id must be increasing
+    INVALID_PRICE,     // AddOrder or ModifyOrder would throw: price must be more than zero (except market orders)
+    UNKNOWN_ORDER_ID,  // cancel or modify of an order that is not resting in the book
+};
+
+struct MessageResult {
+    MessageStatus status{MessageStatus::OK};
+    uint32_t price{};     // GET_BEST_BID: best bid price
+    uint32_t quantity{};  // GET_BEST_BID: quantity at best bid, GET_ASK_VOLUME_BETWEEN_PRICES: ask volume,
+                          // ADD_ORDER of a MARKET, IOC or FOK order: executed quantity
+
+    bool operator==(const MessageResult& other) const = default;
 };
 
 #endif  // ORDER_HPP
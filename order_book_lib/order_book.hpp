@@ -1,48 +1,184 @@
 #ifndef ORDERBOOK_HPP
 #define ORDERBOOK_HPP
 #include <cstdint>  // defines uint32 type
-#include <map>
-#include <unordered_map>
+#include <functional>
+#include <span>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "book_policy.hpp"
+#include "book_snapshot.hpp"
+#include "event_sink.hpp"
 #include "level.hpp"
 #include "order.hpp"
+#include "order_pool.hpp"
+#include "top_of_book.hpp"
 #include "trade.hpp"
 
-class OrderBook {
+/*
+ * Initial sizes of the data structures of a book. The defaults suit one busy instrument, an engine holding thousands
+ * of mostly quiet instruments gives each book small ones, they grow on demand.
+ */
+struct BookSizing {
+    size_t reserved_orders{OrderPool::kDefaultSlabSize};  // pool nodes allocated up front
+    size_t slab_orders{OrderPool::kDefaultSlabSize};      // pool nodes added at once when it runs out, a power of two
+    size_t ladder_ticks{PriceLadder<>::kDefaultTicks};    // initial price window of each side, PriceLadder levels only
+};
+
+/*
+ * Limit order book of one instrument. Execution reports (fills, cancels, rejects, level changes) are handed to Sink,
+ * chosen at compile time so the calls are inlined and cost nothing for the NullEventSink. Policy selects the data
+ * structures (price levels, level queue, id index, see book_policy.hpp). The side of an order is resolved once when
+ * it enters the book, from there on it is a template argument and the bid and ask paths are compiled separately.
+ */
+template <EventSink Sink, typename Policy = DefaultBookPolicy>
+class BasicOrderBook {
    private:
-    std::unordered_map<uint32_t, std::list<Order>::iterator> bids_db_;  // orderid -> Order struct in Levels std::list
-    std::unordered_map<uint32_t, std::list<Order>::iterator> asks_db_;
+    using Level = typename Policy::Level;
+
+    OrderPool order_pool_;  // storage of every resting order, levels link their orders through it
+
+    typename Policy::OrderIdIndex order_ids_;  // orderid -> Order node in the pool, for both sides
+    OwnerOrderLists owner_orders_;             // owner -> its resting orders, for both sides
 
-    std::map<uint32_t, Level, std::greater<>> bids_level_;  // price -> level object of orders in list
-    std::map<uint32_t, Level> asks_level_;
+    typename Policy::template Levels<std::greater<>> bids_level_;  // price -> level, best (highest) first
+    typename Policy::template Levels<std::less<>> asks_level_;     // best (lowest) first
 
-    std::vector<trade> trades;  // simulate and record trades, used for testing
+    Sink sink_;  // receives the execution reports
 
     uint32_t order_id_tracker_;
 
+    uint64_t message_sequence_{0};  // messages handed to the book so far
+    TopOfBook published_top_;       // last top published to top_of_book_, read by the matching thread only
+    bool top_changed_{false};       // a level at or better than published_top_ changed since the publish
+    TopOfBookCell top_of_book_;     // read by any thread
+
+    template <OrderType Side>
+    auto& LevelsOf() {
+        if constexpr (Side == OrderType::BUY) {
+            return bids_level_;
+        } else {
+            return asks_level_;
+        }
+    }
+    template <typename Levels>
+    static Levels MakeLevels(size_t ticks) {
+        if constexpr (std::is_constructible_v<Levels, size_t>) {
+            return Levels(ticks);
+        } else {
+            return Levels();
+        }
+    }
+    template <OrderType Side>
+    static constexpr OrderType kOpposite = Side == OrderType::BUY ? OrderType::SELL : OrderType::BUY;
+    // True if a Side order at price trades with a resting order of the other side at other_price.
+    template <OrderType Side>
+    static bool Crosses(uint32_t price, uint32_t other_price) {
+        return Side == OrderType::BUY ? price >= other_price : price <= other_price;
+    }
+
+    template <OrderType Side>
+    void ReportLevel(const Level& level);
+    template <OrderType Side>
+    bool LinkOrder(OrderHandle handle);
+    template <OrderType Side>
+    void UnlinkOrder(Level& level, OrderHandle handle);
+    template <OrderType Side>
+    void RemoveOrder(Level& level, OrderHandle handle);
+    template <OrderType Side>
+    void CancelOrder(OrderHandle handle);
+    template <OrderType Side>
+    bool ReplaceOrder(OrderHandle handle, uint32_t price, uint32_t quantity);
+    template <OrderType Side>
+    size_t ReleaseLevel(Level& level);
+    template <OrderType Side>
+    size_t ReleaseLevelsFrom(uint32_t price);
+    template <OrderType Side>
+    uint32_t TakeLiquidity(const Order& order);
+    template <OrderType Side>
+    size_t CopyDepth(std::span<DepthLevel> levels);
+    template <OrderType Side>
+    void AppendSnapshot(std::vector<SnapshotOrder>& records);
+    template <OrderType Side>
+    void RestoreSnapshot(std::span<const SnapshotOrder> records);
+    void PublishTopOfBook();
+
+    MessageStatus ValidateOrder(const Order& order) const;
+    MessageStatus AdmitOrder(const Order& order);
+    bool InsertOrder(const Order& order);
+    uint32_t ExecuteImmediately(const Order& order);
+    bool RemoveOrderById(uint32_t order_id);
+    MessageStatus AmendOrder(uint32_t order_id, uint32_t price, uint32_t quantity);
+    size_t CancelOwned(OwnerId owner, OrderType side);
+    MessageStatus MassCancel(const Order& order, uint32_t& cancelled);
+
    public:
-    OrderBook();
+    // The arguments, if any, are forwarded to the sink constructor.
+    template <typename... SinkArgs>
+        requires(!(std::is_same_v<std::remove_cvref_t<SinkArgs>, BookSizing> || ...))
+    explicit BasicOrderBook(SinkArgs&&... sink_args);
+    template <typename... SinkArgs>
+    explicit BasicOrderBook(const BookSizing& sizing, SinkArgs&&... sink_args);
 
     // prevent OrderBook copying and moving
-    OrderBook(const OrderBook&) = delete;
-    void operator=(const OrderBook&) = delete;
-    OrderBook(OrderBook&&) = delete;
-    void operator=(OrderBook&&) = delete;
+    BasicOrderBook(const BasicOrderBook&) = delete;
+    void operator=(const BasicOrderBook&) = delete;
+    BasicOrderBook(BasicOrderBook&&) = delete;
+    void operator=(BasicOrderBook&&) = delete;
+
+    // Preallocate pool nodes so that order_count orders can rest in the book without allocation.
+    void Reserve(size_t order_count);
+
+    // Write every resting order and the order id tracker to path (book_snapshot.hpp), with sequence stored as is.
+    void SaveSnapshot(const std::string& path, uint64_t sequence = 0);
+    // Restore a snapshot into this book, which must be empty, and return its sequence.
+    uint64_t LoadSnapshot(const std::string& path);
 
     void AddOrder(Order order);
     void CancelOrderbyId(uint32_t order_id);
+    void ModifyOrder(uint32_t order_id, uint32_t price, uint32_t quantity);
+    // Mass cancels, each returns the number of orders cancelled. Every order is reported to the sink as a cancel.
+    // A journaled book takes them as MASS_CANCEL messages through ApplyJournaled() instead, so recovery replays them.
+    size_t CancelOwnerOrders(OwnerId owner, OrderType side = OrderType::UNDEFINED);
+    size_t CancelLevelsFrom(OrderType side, uint32_t price);
+    size_t CancelSide(OrderType side);
+    uint32_t GetOwnerOrderCount(OwnerId owner) const { return owner_orders_.Count(owner); }
+    size_t Apply(std::span<const OrderMessage> messages, std::span<MessageResult> results);
     void ProcessOrders();
-    void ExecuteTrade(uint32_t buy_order_id, uint32_t sellOrderId, double price, uint32_t quantity);
-    std::vector<trade>& GetTrades();
+    void ExecuteTrade(uint32_t buy_order_id, uint32_t sellOrderId, uint32_t price, uint32_t quantity);
+    Sink& GetEventSink() { return sink_; }
+    std::vector<trade>& GetTrades()
+        requires requires(Sink& sink) { sink.GetTrades(); }
+    {
+        return sink_.GetTrades();
+    }
+    // Any thread: consistent snapshots of the best bid and ask, updated after every message that changed them.
+    const TopOfBookCell& GetTopOfBook() const { return top_of_book_; }
+    // Messages handed to the book so far, the sequence number of the last one.
+    uint64_t GetMessageSequence() const { return message_sequence_; }
     std::pair<uint32_t, uint32_t> GetBestBidWithQuantity();
     std::pair<uint32_t, uint32_t> GetBestAskWithQuantity();
     uint32_t GetBestBid();
     uint32_t GetBestAsk();
-    uint32_t GetVolumeBetweenPrices(uint32_t start, uint32_t end);
+    size_t GetDepth(OrderType side, std::span<DepthLevel> levels);
+    uint32_t GetVolumeBetweenPrices(uint32_t start, uint32_t end);  // ask side
+    uint32_t GetBidVolumeBetweenPrices(uint32_t start, uint32_t end);
     unsigned long GetBidQuantity();
     unsigned long GetAskQuantity();
 };
 
+// Default book: execution reports go to a fixed capacity ring drained by a consumer thread.
+using OrderBook = BasicOrderBook<RingBufferEventSink>;
+// Book recording every trade, GetTrades() is only available here. Used for testing.
+using RecordingOrderBook = BasicOrderBook<TradeRecorder>;
+
+#include "order_book_impl.hpp"
+
+// Compiled once in order_book.cpp.
+extern template class BasicOrderBook<RingBufferEventSink>;
+extern template class BasicOrderBook<TradeRecorder>;
+extern template class BasicOrderBook<NullEventSink>;
+
 #endif  // ORDERBOOK_HPP
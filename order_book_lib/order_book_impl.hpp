@@ -0,0 +1,811 @@
+#ifndef ORDERBOOK_IMPL_HPP
+#define ORDERBOOK_IMPL_HPP
+
+// Definitions of the BasicOrderBook members, included by order_book.hpp.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "latency_stats.hpp"
+#include "order_book.hpp"
+
+/*
+ * Report the state of a level after its quantity or orders changed. A change at or better than the published best
+ * price of its side may change the top of book, see PublishTopOfBook().
+ */
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+void BasicOrderBook<Sink, Policy>::ReportLevel(const Level &level) {
+    sink_.OnLevelChange({Side, level.price, level.quantity, level.orders_list.count});
+    if constexpr (Side == OrderType::BUY) {
+        top_changed_ |= published_top_.bid_price == 0 || level.price >= published_top_.bid_price;
+    } else {
+        top_changed_ |= published_top_.ask_price == 0 || level.price <= published_top_.ask_price;
+    }
+}
+
+/*
+ * Append a pooled order at the back of the queue of its price level, creating the level if needed, and report the
+ * level. Returns true if the order crossed the spread. The book is never crossed before, so only this order can cross.
+ */
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+bool BasicOrderBook<Sink, Policy>::LinkOrder(OrderHandle handle) {
+    uint32_t price = order_pool_.Cold(handle).price;
+    auto &levels = LevelsOf<Side>();
+    // Activate the price level if needed, a single array access for the PriceLadder.
+    Level &level = levels.FindOrCreate(price);
+    levels.AddQuantity(level, order_pool_[handle].quantity);  // keeps the cumulative depth index up to date
+    level.orders_list.PushBack(order_pool_, handle);
+    ReportLevel<Side>(level);
+    auto &opposite = LevelsOf<kOpposite<Side>>();
+    return !opposite.empty() && Crosses<Side>(price, opposite.Best().price);
+}
+
+/*
+ * Take a resting order out of its level queue, report the level and release it from the ladder if it became empty.
+ * The order quantity must already be taken off the level quantity. The order keeps its pool node and id.
+ */
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+void BasicOrderBook<Sink, Policy>::UnlinkOrder(Level &level, OrderHandle handle) {
+    level.orders_list.Erase(order_pool_, handle);
+    ReportLevel<Side>(level);
+    if (level.quantity < 1) {  // release empty level from the ladder
+        LevelsOf<Side>().Remove(level.price);
+    }
+}
+
+/*
+ * Unlink a resting order from the id index, its level queue and the pool, report the level and release it from the
+ * ladder if it became empty. The order quantity must already be taken off the level quantity.
+ */
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+void BasicOrderBook<Sink, Policy>::RemoveOrder(Level &level, OrderHandle handle) {
+    const OrderNode &order = order_pool_[handle];
+    order_ids_.Erase(order.order_id);  // 1. remove from id index
+    if (order.owner_id != 0) {
+        owner_orders_.Erase(order_pool_, order.owner_id, handle);  // 2. and from the list of its owner
+    }
+    UnlinkOrder<Side>(level, handle);  // 3. unlink from level queue
+    order_pool_.Free(handle);          // 4. return node to the pool
+}
+
+/*
+ * Take a resting order and its remaining quantity off the book.
+ */
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+void BasicOrderBook<Sink, Policy>::CancelOrder(OrderHandle handle) {
+    const OrderNode &del_target_order = order_pool_[handle];
+    sink_.OnCancel({del_target_order.order_id, del_target_order.quantity});
+    auto &levels = LevelsOf<Side>();
+    Level &ref_level = *levels.Find(order_pool_.Cold(handle).price);  // the price locates its level, one array access
+    levels.ReduceQuantity(ref_level, del_target_order.quantity);
+    RemoveOrder<Side>(ref_level, handle);
+}
+
+/*
+ * Give a resting order a new price and quantity. A quantity reduction at the same price keeps the queue position and
+ * only updates the order and its level. Any other change moves the order to the back of the queue of its new level,
+ * keeping its pool node and id index entry. Returns true if the order crossed the spread.
+ */
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+bool BasicOrderBook<Sink, Policy>::ReplaceOrder(OrderHandle handle, uint32_t price, uint32_t quantity) {
+    OrderNode &order = order_pool_[handle];
+    uint32_t &order_price = order_pool_.Cold(handle).price;
+    auto &levels = LevelsOf<Side>();
+    Level &level = *levels.Find(order_price);
+    if (price == order_price && quantity <= order.quantity) {
+        if (quantity < order.quantity) {
+            levels.ReduceQuantity(level, order.quantity - quantity);
+            order.quantity = quantity;
+            ReportLevel<Side>(level);
+        }
+        return false;  // a reduction never crosses
+    }
+    levels.ReduceQuantity(level, order.quantity);
+    UnlinkOrder<Side>(level, handle);
+    order_price = price;
+    order.quantity = quantity;
+    return LinkOrder<Side>(handle);
+}
+
+/*
+ * Check if we can match sell and buy orders in the OrderBook for trades to happen.
+ * If trade happens, delete Orders with zero quantity left.
+ */
+template <EventSink Sink, typename Policy>
+void BasicOrderBook<Sink, Policy>::ProcessOrders() {
+    while (!bids_level_.empty() and !asks_level_.empty()) {
+        uint32_t best_bid = GetBestBid();
+        uint32_t best_ask = GetBestAsk();
+        if (best_bid >= best_ask) {
+            Level &bid_level = bids_level_.Best();
+            Level &ask_level = asks_level_.Best();
+            OrderHandle bid_handle = bid_level.orders_list.front();
+            OrderHandle ask_handle = ask_level.orders_list.front();
+            OrderNode &bid_order = order_pool_[bid_handle];
+            OrderNode &ask_order = order_pool_[ask_handle];
+
+            uint32_t traded_amount = std::min(bid_order.quantity, ask_order.quantity);
+
+            // Reduce quantity of trade of both ask and bid, and their holding level.
+            uint32_t new_bid_quantity = bid_order.quantity - traded_amount;
+            bids_level_.ReduceQuantity(bid_level, traded_amount);
+            bid_order.quantity = new_bid_quantity;
+
+            uint32_t new_ask_quantity = ask_order.quantity - traded_amount;
+            asks_level_.ReduceQuantity(ask_level, traded_amount);
+            ask_order.quantity = new_ask_quantity;
+
+            // Report the fill to the event sink.
+            ExecuteTrade(bid_order.order_id, ask_order.order_id, ask_level.price, traded_amount);
+
+            // Remove empty orders from id index, level queue and pool, and purge empty level with zero orders.
+            // Both levels are reported in their new state.
+            if (bid_order.quantity == 0) {
+                RemoveOrder<OrderType::BUY>(bid_level, bid_handle);
+            } else {
+                ReportLevel<OrderType::BUY>(bid_level);
+            }
+            if (ask_order.quantity == 0) {
+                RemoveOrder<OrderType::SELL>(ask_level, ask_handle);
+            } else {
+                ReportLevel<OrderType::SELL>(ask_level);
+            }
+        } else {
+            break;
+        }  // no orders to match
+    }
+}
+
+template <EventSink Sink, typename Policy>
+template <typename... SinkArgs>
+    requires(!(std::is_same_v<std::remove_cvref_t<SinkArgs>, BookSizing> || ...))
+BasicOrderBook<Sink, Policy>::BasicOrderBook(SinkArgs &&...sink_args)
+    : BasicOrderBook(BookSizing{}, std::forward<SinkArgs>(sink_args)...) {}
+
+template <EventSink Sink, typename Policy>
+template <typename... SinkArgs>
+BasicOrderBook<Sink, Policy>::BasicOrderBook(const BookSizing &sizing, SinkArgs &&...sink_args)
+    : order_pool_(sizing.reserved_orders, sizing.slab_orders),
+      bids_level_(MakeLevels<decltype(bids_level_)>(sizing.ladder_ticks)),
+      asks_level_(MakeLevels<decltype(asks_level_)>(sizing.ladder_ticks)),
+      sink_(std::forward<SinkArgs>(sink_args)...) {
+    // Track max order id so far, to keep the rule of increasing order numbers during a day.
+    order_id_tracker_ = 0;
+}
+
+template <EventSink Sink, typename Policy>
+void BasicOrderBook<Sink, Policy>::Reserve(size_t order_count) {
+    order_pool_.Reserve(order_count);
+}
+
+/*
+ * The records are gathered in one buffer and written with a single call, to a temporary file synced and renamed over
+ * path once complete (see WriteSnapshotFile()), so a crash while saving leaves the previous snapshot intact. Throws
+ * std::runtime_error if writing fails.
+ */
+template <EventSink Sink, typename Policy>
+void BasicOrderBook<Sink, Policy>::SaveSnapshot(const std::string &path, uint64_t sequence) {
+    std::vector<SnapshotOrder> records;
+    records.reserve(order_pool_.Size());
+    AppendSnapshot<OrderType::BUY>(records);
+    uint64_t bid_count = records.size();
+    AppendSnapshot<OrderType::SELL>(records);
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.version = kSnapshotVersion;
+    header.record_size = sizeof(SnapshotOrder);
+    header.sequence = sequence;
+    header.bid_count = bid_count;
+    header.order_count = records.size();
+    header.order_id_tracker = order_id_tracker_;
+
+    WriteSnapshotFile(path, header, records);
+}
+
+/*
+ * The records are read with a single call and the book is rebuilt in bulk: the pool is reserved for every order up
+ * front, the orders are linked level by level in file order and each level updates the depth index once. No event
+ * is reported. Throws std::runtime_error if the file is unreadable or corrupt (including duplicate order ids, crossed
+ * sides and levels out of order), or the book is not empty.
+ */
+template <EventSink Sink, typename Policy>
+uint64_t BasicOrderBook<Sink, Policy>::LoadSnapshot(const std::string &path) {
+    if (order_pool_.Size() > 0) {
+        throw std::runtime_error("Snapshot can only be loaded into an empty book.");
+    }
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Snapshot file open failed " + path);
+    }
+    uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    SnapshotHeader header{};
+    if (file_size < sizeof(header) || !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        throw std::runtime_error("Snapshot file too short " + path);
+    }
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 || header.version != kSnapshotVersion ||
+        header.record_size != sizeof(SnapshotOrder) || header.bid_count > header.order_count ||
+        header.order_count != (file_size - sizeof(header)) / sizeof(SnapshotOrder)) {
+        throw std::runtime_error("Corrupt snapshot file " + path);
+    }
+    std::vector<SnapshotOrder> records(header.order_count);
+    if (!file.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(SnapshotOrder))) {
+        throw std::runtime_error("Snapshot read failed " + path);
+    }
+    // every side best level first and each order id once, else the book would cross or lose orders in the id index
+    std::span<const SnapshotOrder> orders(records);
+    std::span<const SnapshotOrder> bids = orders.first(header.bid_count);
+    std::span<const SnapshotOrder> asks = orders.subspan(header.bid_count);
+    bool corrupt = !bids.empty() && !asks.empty() && bids.front().price >= asks.front().price;
+    for (size_t i = 1; i < bids.size(); i++) corrupt |= bids[i].price > bids[i - 1].price;
+    for (size_t i = 1; i < asks.size(); i++) corrupt |= asks[i].price < asks[i - 1].price;
+    for (const SnapshotOrder &record : records) {
+        corrupt |= record.quantity < 1 || record.price < 1 || record.order_id > header.order_id_tracker;
+    }
+    if (corrupt || HasDuplicateOrderIds(records)) {
+        throw std::runtime_error("Corrupt snapshot file " + path);
+    }
+
+    order_pool_.Reserve(records.size());
+    RestoreSnapshot<OrderType::BUY>(bids);
+    RestoreSnapshot<OrderType::SELL>(asks);
+    order_id_tracker_ = std::max(order_id_tracker_, header.order_id_tracker);
+    top_changed_ = true;  // the restore reports no level
+    PublishTopOfBook();
+    return header.sequence;
+}
+
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+void BasicOrderBook<Sink, Policy>::AppendSnapshot(std::vector<SnapshotOrder> &records) {
+    for (Level &level : LevelsOf<Side>()) {
+        level.orders_list.ForEach(order_pool_, [&](OrderHandle handle) {
+            const OrderNode &order = order_pool_[handle];
+            records.push_back({order.order_id, level.price, order.quantity, order.owner_id, 0});
+        });
+    }
+}
+
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+void BasicOrderBook<Sink, Policy>::RestoreSnapshot(std::span<const SnapshotOrder> records) {
+    auto &levels = LevelsOf<Side>();
+    size_t next = 0;
+    while (next < records.size()) {
+        uint32_t price = records[next].price;
+        Level &level = levels.FindOrCreate(price);
+        uint32_t level_quantity = 0;
+        for (; next < records.size() && records[next].price == price; next++) {
+            const SnapshotOrder &record = records[next];
+            OrderHandle handle = order_pool_.Allocate(
+                {Side, record.order_id, price, record.quantity, OrderKind::LIMIT, record.owner_id});
+            order_ids_.Insert(record.order_id, handle);
+            if (record.owner_id != 0) {
+                owner_orders_.Insert(order_pool_, record.owner_id, handle);
+            }
+            level.orders_list.PushBack(order_pool_, handle);
+            level_quantity += record.quantity;
+        }
+        levels.AddQuantity(level, level_quantity);  // one depth index update per level
+    }
+}
+
+/*
+ * Check the order fields, OK if the order may be added to the book.
+ */
+template <EventSink Sink, typename Policy>
+MessageStatus BasicOrderBook<Sink, Policy>::ValidateOrder(const Order &order) const {
+    if (order.quantity < 1) {
+        return MessageStatus::INVALID_QUANTITY;
+    }
+    if (order.orderId <= order_id_tracker_) {
+        return MessageStatus::INVALID_ORDER_ID;
+    }
+    if (order.price < 1 && order.kind != OrderKind::MARKET) {
+        return MessageStatus::INVALID_PRICE;
+    }
+    if (order.order_type == OrderType::UNDEFINED) {
+        return MessageStatus::IGNORED;  // chose to simply ignore undefined orders
+    }
+    return MessageStatus::OK;
+}
+
+/*
+ * Validate an order and report it to the sink if it is rejected.
+ */
+template <EventSink Sink, typename Policy>
+MessageStatus BasicOrderBook<Sink, Policy>::AdmitOrder(const Order &order) {
+    MessageStatus status = ValidateOrder(order);
+    if (status != MessageStatus::OK && status != MessageStatus::IGNORED) {
+        sink_.OnReject({order.orderId, status});
+    }
+    return status;
+}
+
+/*
+ * Rest a validated order in the book without matching. Returns true if the order crossed the spread, so the caller
+ * has to run ProcessOrders(). The book is never crossed before an insert, so only the new order can cross.
+ */
+template <EventSink Sink, typename Policy>
+bool BasicOrderBook<Sink, Policy>::InsertOrder(const Order &order) {
+    order_id_tracker_ = std::max(order_id_tracker_, order.orderId);
+    OrderHandle handle = order_pool_.Allocate(order);  // free list pop, no allocator call
+    order_ids_.Insert(order.orderId, handle);
+    if (order.owner_id != 0) {
+        owner_orders_.Insert(order_pool_, order.owner_id, handle);
+    }
+    return order.order_type == OrderType::BUY ? LinkOrder<OrderType::BUY>(handle) : LinkOrder<OrderType::SELL>(handle);
+}
+
+/*
+ * Execute a validated MARKET, IOC or FOK order against the opposite side and cancel what is left of it. The order
+ * never rests: no pool node, id index entry or level is created for it. Returns the executed quantity.
+ */
+template <EventSink Sink, typename Policy>
+uint32_t BasicOrderBook<Sink, Policy>::ExecuteImmediately(const Order &order) {
+    order_id_tracker_ = std::max(order_id_tracker_, order.orderId);
+    return order.order_type == OrderType::BUY ? TakeLiquidity<OrderType::BUY>(order)
+                                              : TakeLiquidity<OrderType::SELL>(order);
+}
+
+/*
+ * Match an incoming Side order against the resting orders of the opposite side, best level and oldest order first, at
+ * the price of the resting orders. Stops when the order is filled or the next level is beyond its limit price (MARKET
+ * orders have none), the remainder is cancelled. A FOK order first checks the aggregate quantity up to its limit
+ * price on the cumulative depth index and is killed without trading if it is short. Returns the executed quantity.
+ */
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+uint32_t BasicOrderBook<Sink, Policy>::TakeLiquidity(const Order &order) {
+    constexpr OrderType kRestingSide = kOpposite<Side>;
+    auto &levels = LevelsOf<kRestingSide>();
+    if (order.kind == OrderKind::FOK) {
+        uint64_t available = Side == OrderType::BUY ? levels.VolumeBetween(0, order.price)
+                                                    : levels.VolumeBetween(order.price, UINT32_MAX);
+        if (available < order.quantity) {
+            sink_.OnCancel({order.orderId, order.quantity});
+            return 0;
+        }
+    }
+    uint32_t remaining = order.quantity;
+    while (remaining > 0 && !levels.empty()) {
+        Level &level = levels.Best();
+        if (order.kind != OrderKind::MARKET && !Crosses<Side>(order.price, level.price)) {
+            break;
+        }
+        OrderHandle handle = level.orders_list.front();
+        OrderNode &resting_order = order_pool_[handle];
+        uint32_t traded_amount = std::min(remaining, resting_order.quantity);
+        levels.ReduceQuantity(level, traded_amount);
+        resting_order.quantity -= traded_amount;
+        remaining -= traded_amount;
+        if constexpr (Side == OrderType::BUY) {
+            ExecuteTrade(order.orderId, resting_order.order_id, level.price, traded_amount);
+        } else {
+            ExecuteTrade(resting_order.order_id, order.orderId, level.price, traded_amount);
+        }
+        if (resting_order.quantity == 0) {
+            RemoveOrder<kRestingSide>(level, handle);
+        } else {
+            ReportLevel<kRestingSide>(level);
+        }
+    }
+    if (remaining > 0) {
+        sink_.OnCancel({order.orderId, remaining});
+    }
+    return order.quantity - remaining;
+}
+
+template <EventSink Sink, typename Policy>
+void BasicOrderBook<Sink, Policy>::AddOrder(Order order) {
+    message_sequence_++;
+    switch (AdmitOrder(order)) {
+        case MessageStatus::INVALID_QUANTITY:
+            throw std::invalid_argument("Quantity must be more than zero.");
+        case MessageStatus::INVALID_ORDER_ID:
+            throw std::invalid_argument("Order ID must be increasing and uniq number.");
+        case MessageStatus::INVALID_PRICE:
+            throw std::invalid_argument("Price must be more than zero.");
+        case MessageStatus::OK:
+            break;
+        default:
+            return;
+    }
+    if (order.kind != OrderKind::LIMIT) {
+        ExecuteImmediately(order);
+    } else if (InsertOrder(order)) {
+        // After adding new price point, run processing to see if we can fulfill any orders.
+        ProcessOrders();
+    }
+    PublishTopOfBook();
+}
+
+/*
+ * Cancel an order based on order id.
+ */
+template <EventSink Sink, typename Policy>
+void BasicOrderBook<Sink, Policy>::CancelOrderbyId(uint32_t order_id) {
+    message_sequence_++;
+    RemoveOrderById(order_id);
+    PublishTopOfBook();
+}
+
+/*
+ * Cancel a resting order, false if there is no order with order_id in the book. Both outcomes are reported to the
+ * sink, an unknown id as a reject.
+ */
+template <EventSink Sink, typename Policy>
+bool BasicOrderBook<Sink, Policy>::RemoveOrderById(uint32_t order_id) {
+    OrderHandle handle = order_ids_.Find(order_id);  // one indexed load, no hashing
+    if (handle == kNullOrderHandle) {
+        sink_.OnReject({order_id, MessageStatus::UNKNOWN_ORDER_ID});
+        return false;  // unknown or already filled order
+    }
+    if (order_pool_[handle].side == OrderType::BUY) {
+        CancelOrder<OrderType::BUY>(handle);
+    } else {
+        CancelOrder<OrderType::SELL>(handle);
+    }
+    return true;
+}
+
+/*
+ * Cancel every resting order of owner, of one side only unless side is UNDEFINED. Walks the list of the owner, the
+ * orders of the other owners are not touched. Orders without owner (0) cannot be cancelled this way.
+ */
+template <EventSink Sink, typename Policy>
+size_t BasicOrderBook<Sink, Policy>::CancelOwnerOrders(OwnerId owner, OrderType side) {
+    message_sequence_++;
+    size_t cancelled = CancelOwned(owner, side);
+    PublishTopOfBook();
+    return cancelled;
+}
+
+template <EventSink Sink, typename Policy>
+size_t BasicOrderBook<Sink, Policy>::CancelOwned(OwnerId owner, OrderType side) {
+    size_t cancelled = 0;
+    if (owner != 0) {
+        for (OrderHandle handle = owner_orders_.Head(owner); handle != kNullOrderHandle;) {
+            OrderHandle next = order_pool_.Cold(handle).owner_next;
+            OrderType order_side = order_pool_[handle].side;
+            if (side == OrderType::UNDEFINED || side == order_side) {
+                if (order_side == OrderType::BUY) {
+                    CancelOrder<OrderType::BUY>(handle);
+                } else {
+                    CancelOrder<OrderType::SELL>(handle);
+                }
+                cancelled++;
+            }
+            handle = next;
+        }
+    }
+    return cancelled;
+}
+
+/*
+ * Cancel every resting order of side at price or beyond it: bids at or below price, asks at or above it. Whole levels
+ * are released at once, see ReleaseLevel().
+ */
+template <EventSink Sink, typename Policy>
+size_t BasicOrderBook<Sink, Policy>::CancelLevelsFrom(OrderType side, uint32_t price) {
+    message_sequence_++;
+    size_t cancelled = 0;
+    if (side == OrderType::BUY) {
+        cancelled = ReleaseLevelsFrom<OrderType::BUY>(price);
+    } else if (side == OrderType::SELL) {
+        cancelled = ReleaseLevelsFrom<OrderType::SELL>(price);
+    }
+    PublishTopOfBook();
+    return cancelled;
+}
+
+/*
+ * MASS_CANCEL message: the orders of order.owner_id on side order.order_type (both sides when UNDEFINED), or without
+ * an owner the levels of side order.order_type from order.price outward, as CancelLevelsFrom().
+ */
+template <EventSink Sink, typename Policy>
+MessageStatus BasicOrderBook<Sink, Policy>::MassCancel(const Order &order, uint32_t &cancelled) {
+    if (order.owner_id != 0) {
+        cancelled = static_cast<uint32_t>(CancelOwned(order.owner_id, order.order_type));
+    } else if (order.order_type == OrderType::BUY) {
+        cancelled = static_cast<uint32_t>(ReleaseLevelsFrom<OrderType::BUY>(order.price));
+    } else if (order.order_type == OrderType::SELL) {
+        cancelled = static_cast<uint32_t>(ReleaseLevelsFrom<OrderType::SELL>(order.price));
+    } else {
+        return MessageStatus::IGNORED;  // neither an owner nor a side
+    }
+    return MessageStatus::OK;
+}
+
+/*
+ * Cancel every resting order of side.
+ */
+template <EventSink Sink, typename Policy>
+size_t BasicOrderBook<Sink, Policy>::CancelSide(OrderType side) {
+    return CancelLevelsFrom(side, side == OrderType::BUY ? UINT32_MAX : 0);
+}
+
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+size_t BasicOrderBook<Sink, Policy>::ReleaseLevelsFrom(uint32_t price) {
+    auto &levels = LevelsOf<Side>();
+    size_t cancelled = 0;
+    for (auto level = levels.lower_bound(price); level != levels.end(); level = levels.lower_bound(price)) {
+        cancelled += ReleaseLevel<Side>(*level);
+    }
+    return cancelled;
+}
+
+/*
+ * Cancel every order of a level and release the level. The orders leave the id index, the owner lists and the pool
+ * one by one, without unlinking them from the queue; the level quantity and depth index are updated, reported and
+ * released once for the whole level. Returns the number of orders cancelled.
+ */
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+size_t BasicOrderBook<Sink, Policy>::ReleaseLevel(Level &level) {
+    size_t count = level.orders_list.count;
+    level.orders_list.ForEach(order_pool_, [&](OrderHandle handle) {
+        const OrderNode &order = order_pool_[handle];
+        sink_.OnCancel({order.order_id, order.quantity});
+        order_ids_.Erase(order.order_id);
+        if (order.owner_id != 0) {
+            owner_orders_.Erase(order_pool_, order.owner_id, handle);
+        }
+        order_pool_.Free(handle);
+    });
+    auto &levels = LevelsOf<Side>();
+    levels.ReduceQuantity(level, level.quantity);
+    level.orders_list = {};
+    ReportLevel<Side>(level);
+    levels.Remove(level.price);
+    return count;
+}
+
+/*
+ * Change the price and quantity of a resting order, see ReplaceOrder(). The order keeps its id and side. Invalid
+ * values and unknown ids are reported to the sink as rejects and leave the book unchanged.
+ */
+template <EventSink Sink, typename Policy>
+MessageStatus BasicOrderBook<Sink, Policy>::AmendOrder(uint32_t order_id, uint32_t price, uint32_t quantity) {
+    MessageStatus status = MessageStatus::OK;
+    OrderHandle handle = order_ids_.Find(order_id);
+    if (quantity < 1) {
+        status = MessageStatus::INVALID_QUANTITY;  // a modify to zero is a cancel
+    } else if (price < 1) {
+        status = MessageStatus::INVALID_PRICE;
+    } else if (handle == kNullOrderHandle) {
+        status = MessageStatus::UNKNOWN_ORDER_ID;  // unknown or already filled order
+    }
+    if (status != MessageStatus::OK) {
+        sink_.OnReject({order_id, status});
+        return status;
+    }
+    bool crossed = order_pool_[handle].side == OrderType::BUY
+                       ? ReplaceOrder<OrderType::BUY>(handle, price, quantity)
+                       : ReplaceOrder<OrderType::SELL>(handle, price, quantity);
+    if (crossed) {
+        ProcessOrders();
+    }
+    return status;
+}
+
+/*
+ * Modify an order based on order id: a quantity reduction keeps its priority, a new price or a larger quantity sends
+ * it to the back of the queue of its new level, where it can trade. Unknown ids are ignored like in CancelOrderbyId.
+ */
+template <EventSink Sink, typename Policy>
+void BasicOrderBook<Sink, Policy>::ModifyOrder(uint32_t order_id, uint32_t price, uint32_t quantity) {
+    message_sequence_++;
+    MessageStatus status = AmendOrder(order_id, price, quantity);
+    PublishTopOfBook();
+    switch (status) {
+        case MessageStatus::INVALID_QUANTITY:
+            throw std::invalid_argument("Quantity must be more than zero.");
+        case MessageStatus::INVALID_PRICE:
+            throw std::invalid_argument("Price must be more than zero.");
+        default:
+            return;
+    }
+}
+
+/*
+ * Apply a packet of order messages in order and write one result per message, the results and trades are identical
+ * to calling AddOrder, CancelOrderbyId, ModifyOrder, the mass cancels and the queries one message at a time. Invalid
+ * orders are reported in the result instead of throwing, and matching only runs for an add or modify that crossed the
+ * spread. Returns the number of messages applied, results must have room for every message.
+ */
+template <EventSink Sink, typename Policy>
+size_t BasicOrderBook<Sink, Policy>::Apply(std::span<const OrderMessage> messages, std::span<MessageResult> results) {
+    if (results.size() < messages.size()) {
+        throw std::invalid_argument("Results buffer must have room for every message.");
+    }
+    for (size_t i = 0; i < messages.size(); i++) {
+        LATENCY_STATS(uint64_t start_tsc = ReadTsc());
+        message_sequence_++;
+        const OrderMessage &message = messages[i];
+        MessageResult &result = results[i];
+        result = MessageResult{};
+        switch (message.order_message_type) {
+            case OrderMessageType::ADD_ORDER:
+                result.status = AdmitOrder(message.order);
+                if (result.status != MessageStatus::OK) {
+                    break;
+                }
+                if (message.order.kind != OrderKind::LIMIT) {
+                    result.quantity = ExecuteImmediately(message.order);
+                } else if (InsertOrder(message.order)) {
+                    ProcessOrders();
+                }
+                PublishTopOfBook();
+                break;
+            case OrderMessageType::CANCEL_ORDER:
+                if (!RemoveOrderById(message.order.orderId)) {
+                    result.status = MessageStatus::UNKNOWN_ORDER_ID;
+                }
+                PublishTopOfBook();
+                break;
+            case OrderMessageType::MODIFY_ORDER:
+                result.status = AmendOrder(message.order.orderId, message.order.price, message.order.quantity);
+                PublishTopOfBook();
+                break;
+            case OrderMessageType::MASS_CANCEL:
+                result.status = MassCancel(message.order, result.quantity);
+                PublishTopOfBook();
+                break;
+            case OrderMessageType::GET_BEST_BID:
+                std::tie(result.price, result.quantity) = GetBestBidWithQuantity();
+                break;
+            case OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES:
+                result.quantity = GetVolumeBetweenPrices(message.lower_price, message.upper_price);
+                break;
+            default:
+                result.status = MessageStatus::IGNORED;
+        }
+        LATENCY_STATS(ThreadLatencyRecorder().RecordServiceTime(message.order_message_type, ReadTsc() - start_tsc));
+    }
+    return messages.size();
+}
+
+/*
+ * Report a fill. Timestamping and recording are left to the sink, the matching path does not read a clock.
+ */
+template <EventSink Sink, typename Policy>
+void BasicOrderBook<Sink, Policy>::ExecuteTrade(uint32_t buy_order_id, uint32_t sellOrderId, uint32_t price,
+                                        uint32_t quantity) {
+    sink_.OnTrade({buy_order_id, sellOrderId, price, quantity});
+}
+
+/*
+ * Publish the best bid and ask to the top of book cell if the last message changed them. Only a level change at or
+ * better than a published best price can, so a message that did not reach the best levels (a query, a reject, a change
+ * deeper in the book) costs a flag test.
+ */
+template <EventSink Sink, typename Policy>
+void BasicOrderBook<Sink, Policy>::PublishTopOfBook() {
+    if (!top_changed_) {
+        return;
+    }
+    top_changed_ = false;
+    TopOfBook top;
+    std::tie(top.bid_price, top.bid_quantity) = GetBestBidWithQuantity();
+    std::tie(top.ask_price, top.ask_quantity) = GetBestAskWithQuantity();
+    if (top.SameQuotes(published_top_)) {
+        return;
+    }
+    top.sequence = message_sequence_;
+    published_top_ = top;
+    top_of_book_.Publish(top);
+}
+
+/*
+ * Return pair of Price and Quantity.
+ * If there are multiple bids on the same price (same level) their quantites are
+ * added together.
+ */
+template <EventSink Sink, typename Policy>
+std::pair<uint32_t, uint32_t> BasicOrderBook<Sink, Policy>::GetBestBidWithQuantity() {
+    if (bids_level_.empty()) {
+        return std::make_pair(0, 0);
+    }
+    Level &best = bids_level_.Best();
+    return std::make_pair(best.price, best.quantity);
+}
+
+/*
+ * Return pair of 1:Price and 2:Quantity.
+ * If there are multiple bids on the same price (same level) their quantites are
+ * added together.
+ */
+template <EventSink Sink, typename Policy>
+std::pair<uint32_t, uint32_t> BasicOrderBook<Sink, Policy>::GetBestAskWithQuantity() {
+    if (asks_level_.empty()) {
+        return std::make_pair(0, 0);
+    }
+    Level &best = asks_level_.Best();
+    return std::make_pair(best.price, best.quantity);
+}
+
+/*
+ * Fill levels with the best levels of one side, best first: price, quantity and number of orders. Returns the number
+ * of levels written, less than levels.size() when the side has fewer levels. Walks the occupied levels only and does
+ * not allocate.
+ */
+template <EventSink Sink, typename Policy>
+size_t BasicOrderBook<Sink, Policy>::GetDepth(OrderType side, std::span<DepthLevel> levels) {
+    if (side == OrderType::BUY) {
+        return CopyDepth<OrderType::BUY>(levels);
+    }
+    if (side == OrderType::SELL) {
+        return CopyDepth<OrderType::SELL>(levels);
+    }
+    return 0;
+}
+
+template <EventSink Sink, typename Policy>
+template <OrderType Side>
+size_t BasicOrderBook<Sink, Policy>::CopyDepth(std::span<DepthLevel> levels) {
+    auto &ladder = LevelsOf<Side>();
+    size_t count = 0;
+    for (auto level = ladder.begin(); level != ladder.end() && count < levels.size(); ++level) {
+        levels[count++] = {level->price, level->quantity, level->orders_list.count};
+    }
+    return count;
+}
+
+/*
+ * Returns the quantity of ask orders between start and end input values, both
+ * being inclusive. O(log P) on the cumulative depth index, independent of the width of the range.
+ */
+template <EventSink Sink, typename Policy>
+uint32_t BasicOrderBook<Sink, Policy>::GetVolumeBetweenPrices(uint32_t start, uint32_t end) {
+    return asks_level_.VolumeBetween(start, end);
+}
+
+/*
+ * Returns the quantity of bid orders between start and end input values, both
+ * being inclusive.
+ */
+template <EventSink Sink, typename Policy>
+uint32_t BasicOrderBook<Sink, Policy>::GetBidVolumeBetweenPrices(uint32_t start, uint32_t end) {
+    return bids_level_.VolumeBetween(start, end);
+}
+
+template <EventSink Sink, typename Policy>
+unsigned long BasicOrderBook<Sink, Policy>::GetBidQuantity() {
+    return bids_level_.TotalQuantity();
+}
+
+template <EventSink Sink, typename Policy>
+unsigned long BasicOrderBook<Sink, Policy>::GetAskQuantity() {
+    return asks_level_.TotalQuantity();
+}
+
+template <EventSink Sink, typename Policy>
+uint32_t BasicOrderBook<Sink, Policy>::GetBestBid() {
+    if (bids_level_.empty()) {
+        return 0;
+    }
+    return bids_level_.Best().price;
+}
+
+template <EventSink Sink, typename Policy>
+uint32_t BasicOrderBook<Sink, Policy>::GetBestAsk() {
+    if (asks_level_.empty()) {
+        return 0;
+    }
+    return asks_level_.Best().price;
+}
+
+#endif  // ORDERBOOK_IMPL_HPP
@@ -0,0 +1,141 @@
+#include "order_flow_generator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+uint64_t SplitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+uint64_t RotateLeft(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+}  // namespace
+
+OrderFlowGenerator::OrderFlowGenerator(const OrderFlowConfig& config)
+    : config_(config), last_price_(config.start_price), ask_prices_(config.price_history) {
+    weight_total_ = config.add_weight + config.cancel_weight + config.best_bid_weight + config.ask_volume_weight;
+    if (config.add_weight < 0 || config.cancel_weight < 0 || config.best_bid_weight < 0 ||
+        config.ask_volume_weight < 0 || !(config.add_weight > 0)) {
+        throw std::invalid_argument("Order flow weights must not be negative and adds must have a weight.");
+    }
+    if (config.burstiness < 0 || config.burstiness >= 1) {
+        throw std::invalid_argument("Order flow burstiness must be in [0, 1).");
+    }
+    if (config.start_price < 1 || config.price_history < 2) {
+        throw std::invalid_argument("Order flow needs a start price and at least two prices of history.");
+    }
+    uint64_t seed = config.seed;
+    for (uint64_t& word : state_) word = SplitMix64(seed);
+}
+
+// xoshiro256**
+uint64_t OrderFlowGenerator::NextRandom() {
+    uint64_t result = RotateLeft(state_[1] * 5, 7) * 9;
+    uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = RotateLeft(state_[3], 45);
+    return result;
+}
+
+uint32_t OrderFlowGenerator::Below(uint32_t bound) {
+    return static_cast<uint32_t>(((NextRandom() >> 32) * bound) >> 32);  // multiply-shift, no division
+}
+
+double OrderFlowGenerator::NextUnit() { return static_cast<double>(NextRandom() >> 11) * 0x1.0p-53; }
+
+OrderMessageType OrderFlowGenerator::NextType() {
+    if (last_type_ != OrderMessageType::UNDEFINED && config_.burstiness > 0 && NextUnit() < config_.burstiness) {
+        return last_type_;
+    }
+    double pick = NextUnit() * weight_total_;
+    if ((pick -= config_.add_weight) < 0) return OrderMessageType::ADD_ORDER;
+    if ((pick -= config_.cancel_weight) < 0) return OrderMessageType::CANCEL_ORDER;
+    if ((pick -= config_.best_bid_weight) < 0) return OrderMessageType::GET_BEST_BID;
+    return OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES;
+}
+
+OrderMessage OrderFlowGenerator::NextAdd() {
+    OrderType side = Below(2) == 0 ? OrderType::BUY : OrderType::SELL;
+
+    // if price reaches 500, bias towards reduction until it gets back under 200, if it reaches 100 bias towards
+    // increasing until it gets back over 200
+    if (last_price_ >= 500) high_limit_mode_ = true;
+    if (last_price_ <= 100) low_limit_mode_ = true;
+    int64_t price = last_price_;
+    if (high_limit_mode_) {
+        price += static_cast<int64_t>(Below(6)) - 3;  // -3..2
+        if (price < 200) high_limit_mode_ = false;
+    } else if (low_limit_mode_) {
+        price += static_cast<int64_t>(Below(6)) - 2;  // -2..3
+        if (price > 200) low_limit_mode_ = false;
+    } else {
+        price += static_cast<int64_t>(Below(5)) - 2;  // -2..2
+    }
+    last_price_ = static_cast<uint32_t>(std::max<int64_t>(price, 1));
+
+    if (side == OrderType::SELL) {
+        ask_prices_[ask_price_count_++ % ask_prices_.size()] = last_price_;
+    }
+    uint32_t order_id = static_cast<uint32_t>(message_number_);
+    resting_.push_back(order_id);
+
+    OrderMessage message;
+    message.order_message_type = OrderMessageType::ADD_ORDER;
+    message.order = {side, order_id, last_price_, 1 + Below(100)};
+    return message;
+}
+
+OrderMessage OrderFlowGenerator::Next() {
+    if (message_number_ == kMaxMessageCount) {
+        throw std::out_of_range("Order flow is limited to 2^32 - 1 messages, the order ids would wrap.");
+    }
+    message_number_++;
+    OrderMessageType type = NextType();
+    if (type == OrderMessageType::ADD_ORDER && config_.book_depth > 0 && resting_.size() >= config_.book_depth) {
+        type = OrderMessageType::CANCEL_ORDER;
+    }
+    // like data_generator.py, a cancel without an order or a volume query without two prices becomes an add
+    size_t ask_prices = std::min(ask_price_count_, ask_prices_.size());
+    if ((type == OrderMessageType::CANCEL_ORDER && resting_.empty()) ||
+        (type == OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES && ask_prices < 2)) {
+        type = OrderMessageType::ADD_ORDER;
+    }
+    last_type_ = type;
+
+    OrderMessage message;
+    message.order_message_type = type;
+    switch (type) {
+        case OrderMessageType::ADD_ORDER:
+            return NextAdd();
+        case OrderMessageType::CANCEL_ORDER: {
+            size_t index = Below(static_cast<uint32_t>(resting_.size()));
+            message.order.orderId = resting_[index];
+            resting_[index] = resting_.back();
+            resting_.pop_back();
+            break;
+        }
+        case OrderMessageType::GET_ASK_VOLUME_BETWEEN_PRICES: {
+            // two different entries of the history
+            uint32_t first = Below(static_cast<uint32_t>(ask_prices));
+            uint32_t second = Below(static_cast<uint32_t>(ask_prices) - 1);
+            second += second >= first ? 1 : 0;
+            auto [low, high] = std::minmax(ask_prices_[first], ask_prices_[second]);
+            message.lower_price = static_cast<int>(low);
+            message.upper_price = static_cast<int>(high);
+            break;
+        }
+        default:
+            break;
+    }
+    return message;
+}
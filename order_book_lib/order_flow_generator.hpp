@@ -0,0 +1,75 @@
+#ifndef ORDER_FLOW_GENERATOR_HPP
+#define ORDER_FLOW_GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "order.hpp"
+
+struct OrderFlowConfig {
+    uint64_t seed{1};
+    uint32_t start_price{150};
+    // Message mix, relative weights. The defaults are the mix of data_generator.py.
+    double add_weight{0.25};
+    double cancel_weight{0.15};
+    double best_bid_weight{0.40};
+    double ask_volume_weight{0.20};
+    // Resting orders tracked at most, an add beyond them is turned into a cancel of one of them. 0: no limit.
+    size_t book_depth{0};
+    // Chance that a message repeats the type of the previous one, giving runs of adds, cancels and queries. 0: every
+    // type is drawn from the weights.
+    double burstiness{0.0};
+    size_t price_history{100};  // latest ask prices the GetAskVolumeBetweenPrices bounds are sampled from
+};
+
+/*
+ * Seeded synthetic order flow, the native version of dataset_creator/data_generator.py: the same price model (a
+ * random walk of -2..+2 ticks per order, biased down above 500 until it is back under 200 and biased up below 100
+ * until it is back over 200), quantities 1..100, cancels of random orders added before and ask volume queries between
+ * two of the latest ask prices. The order id of an add is the message number, starting at 1, so a flow is at most
+ * kMaxMessageCount messages long: order ids are 32-bit and must not wrap.
+ * Messages are generated on demand, so a flow of any size streams into a book or a file in constant memory (apart
+ * from the tracked resting orders, see book_depth). The random generator is xoshiro256**, the same seed gives the same
+ * flow on every platform.
+ */
+class OrderFlowGenerator {
+   public:
+    static constexpr uint64_t kMaxMessageCount = UINT32_MAX;
+
+    explicit OrderFlowGenerator(const OrderFlowConfig& config = {});
+
+    // Throws std::out_of_range past kMaxMessageCount messages.
+    OrderMessage Next();
+
+    // Fill messages with the next messages of the flow.
+    void Next(std::span<OrderMessage> messages) {
+        for (OrderMessage& message : messages) message = Next();
+    }
+
+    uint64_t GeneratedCount() const { return message_number_; }
+    size_t RestingCount() const { return resting_.size(); }
+
+   private:
+    uint64_t NextRandom();
+    uint32_t Below(uint32_t bound);  // uniform in [0, bound)
+    double NextUnit();               // uniform in [0, 1)
+    OrderMessageType NextType();
+    OrderMessage NextAdd();
+
+    OrderFlowConfig config_;
+    uint64_t state_[4];
+    double weight_total_;
+
+    uint64_t message_number_{0};
+    OrderMessageType last_type_{OrderMessageType::UNDEFINED};
+    uint32_t last_price_;
+    bool high_limit_mode_{false};
+    bool low_limit_mode_{false};
+    std::vector<uint32_t> resting_;     // order ids that may be cancelled
+    std::vector<uint32_t> ask_prices_;  // ring of the latest ask prices
+    size_t ask_price_count_{0};
+};
+
+#endif  // ORDER_FLOW_GENERATOR_HPP
@@ -0,0 +1,128 @@
+#ifndef ORDER_ID_INDEX_HPP
+#define ORDER_ID_INDEX_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "order_pool.hpp"
+
+/* OrderIdIndex maps an order id to the pool handle of a resting order, for both sides of the book.
+ * Order ids are strictly increasing, so live ids are concentrated in a sliding window: the index is a table of pages,
+ * each page a plain array of handles for kPageSize consecutive ids. A lookup is the page pointer plus one indexed load,
+ * there is no hashing. A page whose orders are all gone is recycled for newer ids, and the table drops dead pages
+ * from its front, so memory follows the number of live ids rather than the highest id.
+ */
+class OrderIdIndex {
+   public:
+    static constexpr size_t kPageBits = 12;
+    static constexpr size_t kPageSize = size_t{1} << kPageBits;  // ids per page
+
+    OrderIdIndex() = default;
+    OrderIdIndex(const OrderIdIndex&) = delete;
+    OrderIdIndex& operator=(const OrderIdIndex&) = delete;
+
+    // Handle of the order with order_id, kNullOrderHandle if it is not resting in the book.
+    OrderHandle Find(uint32_t order_id) const {
+        uint32_t page_number = order_id >> kPageBits;
+        if (page_number < first_page_ || page_number - first_page_ >= pages_.size()) return kNullOrderHandle;
+        const Page* page = pages_[page_number - first_page_];
+        return page == nullptr ? kNullOrderHandle : page->slots[order_id & (kPageSize - 1)];
+    }
+
+    void Insert(uint32_t order_id, OrderHandle handle) {
+        Page& page = PageFor(order_id >> kPageBits);
+        page.slots[order_id & (kPageSize - 1)] = handle;
+        page.live++;
+    }
+
+    void Erase(uint32_t order_id) {
+        size_t page_index = (order_id >> kPageBits) - first_page_;
+        Page* page = pages_[page_index];
+        page->slots[order_id & (kPageSize - 1)] = kNullOrderHandle;
+        // The newest page keeps receiving ids, every other page is recycled once its last order is gone.
+        if (--page->live == 0 && page_index + 1 < pages_.size()) RetirePage(page_index);
+    }
+
+    size_t PagesAllocated() const { return storage_.size(); }
+
+   private:
+    struct Page {
+        Page() { std::fill(std::begin(slots), std::end(slots), kNullOrderHandle); }
+        OrderHandle slots[kPageSize];
+        uint32_t live{};  // number of non-null slots
+    };
+
+    Page& PageFor(uint32_t page_number) {
+        if (pages_.empty()) first_page_ = page_number;
+        if (page_number < first_page_) {
+            // Ids below the window only happen if ids were not increasing, grow the table at the front.
+            pages_.insert(pages_.begin(), first_page_ - page_number, nullptr);
+            first_page_ = page_number;
+        }
+        if (page_number - first_page_ >= pages_.size()) {
+            bool had_pages = !pages_.empty();
+            size_t newest = pages_.size() - 1;
+            pages_.resize(page_number - first_page_ + 1, nullptr);
+            // The previous newest page is kept even when empty, recycle it now that ids moved past it.
+            if (had_pages && pages_[newest] != nullptr && pages_[newest]->live == 0) RetirePage(newest);
+        }
+        Page*& page = pages_[page_number - first_page_];
+        if (page == nullptr) page = AcquirePage();
+        return *page;
+    }
+
+    Page* AcquirePage() {
+        if (free_pages_.empty()) {
+            storage_.push_back(std::make_unique<Page>());
+            return storage_.back().get();
+        }
+        Page* page = free_pages_.back();
+        free_pages_.pop_back();
+        return page;
+    }
+
+    void RetirePage(size_t page_index) {
+        free_pages_.push_back(pages_[page_index]);  // every slot is already null, the page is ready for reuse
+        pages_[page_index] = nullptr;
+        // Drop the dead pages at the front of the window.
+        size_t dead = 0;
+        while (dead + 1 < pages_.size() && pages_[dead] == nullptr) dead++;
+        if (dead > 0) {
+            pages_.erase(pages_.begin(), pages_.begin() + dead);
+            first_page_ += dead;
+        }
+    }
+
+    uint32_t first_page_{0};                      // page number of pages_[0]
+    std::vector<Page*> pages_;                    // window of pages, nullptr for recycled pages
+    std::vector<Page*> free_pages_;               // recycled pages
+    std::vector<std::unique_ptr<Page>> storage_;  // owns every page
+};
+
+/* HashOrderIdIndex is the hash map index of the Version 2 book, an alternative id index policy. It makes no
+ * assumption on the order of the ids, at the cost of hashing and a node allocation per order.
+ */
+class HashOrderIdIndex {
+   public:
+    HashOrderIdIndex() = default;
+    HashOrderIdIndex(const HashOrderIdIndex&) = delete;
+    HashOrderIdIndex& operator=(const HashOrderIdIndex&) = delete;
+
+    OrderHandle Find(uint32_t order_id) const {
+        auto it = handles_.find(order_id);
+        return it == handles_.end() ? kNullOrderHandle : it->second;
+    }
+
+    void Insert(uint32_t order_id, OrderHandle handle) { handles_[order_id] = handle; }
+    void Erase(uint32_t order_id) { handles_.erase(order_id); }
+
+   private:
+    std::unordered_map<uint32_t, OrderHandle> handles_;
+};
+
+#endif  // ORDER_ID_INDEX_HPP
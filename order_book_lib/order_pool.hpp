@@ -0,0 +1,265 @@
+#ifndef ORDER_POOL_HPP
+#define ORDER_POOL_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "order.hpp"
+
+/* Orders resting in the book live in an OrderPool owned by the OrderBook. Nodes are carved out of fixed size slabs and
+ * recycled through a free list, so adding, filling and cancelling an order do not call the allocator (only growing the
+ * pool past its reserved capacity does). A node is addressed by a 32-bit OrderHandle, which stays valid until the
+ * node is freed.
+ * Each node is split in two 16-byte halves kept in parallel arrays: the OrderNode with what matching reads on every
+ * fill, four to a cache line, and the OrderNodeCold with what only an insert, a cancel or a modify needs. A fill that
+ * walks a level queue touches one line per four orders instead of one or two per order.
+ */
+
+using OrderHandle = uint32_t;
+inline constexpr OrderHandle kNullOrderHandle = UINT32_MAX;
+
+// Hot half of a resting order.
+struct alignas(16) OrderNode {
+    uint32_t order_id{};
+    uint32_t quantity{};
+    OrderHandle next{kNullOrderHandle};  // next order in the level FIFO, also links the free list
+    OwnerId owner_id{0};
+    OrderType side{OrderType::UNDEFINED};
+};
+
+// Cold half of a resting order. Resting orders are always LIMIT orders, the kind is not kept.
+struct OrderNodeCold {
+    uint32_t price{};
+    OrderHandle prev{kNullOrderHandle};        // previous order in the level FIFO, stale for the queue head
+    OrderHandle owner_prev{kNullOrderHandle};  // neighbours in the list of the owner, see OwnerOrderLists
+    OrderHandle owner_next{kNullOrderHandle};
+};
+
+static_assert(sizeof(OrderNode) == 16 && sizeof(OrderNodeCold) == 16);
+
+class OrderPool {
+   public:
+    static constexpr size_t kDefaultSlabSize = 4096;  // nodes per slab
+
+    // The pool grows by slabs of slab_size nodes, a power of two. Small slabs suit books that hold few orders.
+    explicit OrderPool(size_t capacity = kDefaultSlabSize, size_t slab_size = kDefaultSlabSize)
+        : slab_bits_(std::countr_zero(slab_size)), slab_size_(slab_size) {
+        if (slab_size == 0 || !std::has_single_bit(slab_size)) {
+            throw std::invalid_argument("Order pool slab size must be a power of two.");
+        }
+        Reserve(capacity);
+    }
+
+    // prevent copying, handles are only meaningful inside the pool that created them
+    OrderPool(const OrderPool&) = delete;
+    OrderPool& operator=(const OrderPool&) = delete;
+
+    OrderNode& operator[](OrderHandle handle) { return slabs_[handle >> slab_bits_].hot[handle & (slab_size_ - 1)]; }
+    const OrderNode& operator[](OrderHandle handle) const {
+        return slabs_[handle >> slab_bits_].hot[handle & (slab_size_ - 1)];
+    }
+    OrderNodeCold& Cold(OrderHandle handle) { return slabs_[handle >> slab_bits_].cold[handle & (slab_size_ - 1)]; }
+    const OrderNodeCold& Cold(OrderHandle handle) const {
+        return slabs_[handle >> slab_bits_].cold[handle & (slab_size_ - 1)];
+    }
+
+    OrderHandle Allocate(const Order& order) {
+        if (free_head_ == kNullOrderHandle) AddSlab();  // cold path, only when the reserve is exhausted
+        OrderHandle handle = free_head_;
+        OrderNode& node = (*this)[handle];
+        free_head_ = node.next;
+        node = {order.orderId, order.quantity, kNullOrderHandle, order.owner_id, order.order_type};
+        Cold(handle) = {order.price};
+        size_++;
+        return handle;
+    }
+
+    void Free(OrderHandle handle) {
+        (*this)[handle].next = free_head_;
+        free_head_ = handle;
+        size_--;
+    }
+
+    // Preallocate slabs so that capacity orders can rest in the book without allocation.
+    void Reserve(size_t capacity) {
+        while (Capacity() < capacity) AddSlab();
+    }
+
+    size_t Size() const { return size_; }
+    size_t Capacity() const { return slabs_.size() * slab_size_; }
+
+   private:
+    struct Slab {
+        std::unique_ptr<OrderNode[]> hot;
+        std::unique_ptr<OrderNodeCold[]> cold;
+    };
+
+    void AddSlab() {
+        OrderHandle first = static_cast<OrderHandle>(Capacity());
+        slabs_.push_back({std::make_unique<OrderNode[]>(slab_size_), std::make_unique<OrderNodeCold[]>(slab_size_)});
+        // Thread the new nodes onto the free list in address order.
+        OrderNode* slab = slabs_.back().hot.get();
+        for (size_t i = 0; i < slab_size_; i++) {
+            slab[i].next = i + 1 < slab_size_ ? static_cast<OrderHandle>(first + i + 1) : free_head_;
+        }
+        free_head_ = first;
+    }
+
+    std::vector<Slab> slabs_;
+    size_t slab_bits_;
+    size_t slab_size_;
+    OrderHandle free_head_{kNullOrderHandle};
+    size_t size_{};
+};
+
+/* OrderQueue is the intrusive FIFO of one price level. It only stores the first and last handle, the links live in the
+ * pooled nodes, so push and erase are O(1) pointer updates. The forward links are hot and the backward links cold:
+ * taking the head, the only erase of a fill, follows next only and leaves the prev of the new head stale, the head is
+ * recognized by its handle.
+ */
+struct OrderQueue {
+    OrderHandle head{kNullOrderHandle};
+    OrderHandle tail{kNullOrderHandle};
+    uint32_t count{0};  // orders in the queue
+
+    bool empty() const { return head == kNullOrderHandle; }
+    OrderHandle front() const { return head; }
+
+    // Call f(handle) for every order, oldest first. f may free the node of handle.
+    template <typename F>
+    void ForEach(const OrderPool& pool, F&& f) const {
+        for (OrderHandle handle = head; handle != kNullOrderHandle;) {
+            OrderHandle next = pool[handle].next;
+            f(handle);
+            handle = next;
+        }
+    }
+
+    void PushBack(OrderPool& pool, OrderHandle handle) {
+        pool[handle].next = kNullOrderHandle;
+        pool.Cold(handle).prev = tail;
+        if (tail == kNullOrderHandle) {
+            head = handle;
+        } else {
+            pool[tail].next = handle;
+        }
+        tail = handle;
+        count++;
+    }
+
+    void Erase(OrderPool& pool, OrderHandle handle) {
+        OrderHandle next = pool[handle].next;
+        if (handle == head) {
+            head = next;
+            if (next == kNullOrderHandle) {
+                tail = kNullOrderHandle;
+            } else {
+                __builtin_prefetch(&pool[next]);  // the new head is the next order to fill
+            }
+        } else {
+            OrderHandle prev = pool.Cold(handle).prev;
+            pool[prev].next = next;
+            if (next == kNullOrderHandle) {
+                tail = prev;
+            } else {
+                pool.Cold(next).prev = prev;
+            }
+        }
+        count--;
+    }
+};
+
+/* VectorOrderQueue keeps the handles of a level in a vector, consumed from a moving head. Fills take the front in O(1)
+ * and walk memory in order, a cancel from the middle shifts the handles behind it. An alternative queue policy for
+ * books whose levels stay short, it does not use the links of the pool nodes.
+ */
+struct VectorOrderQueue {
+    std::vector<OrderHandle> handles;
+    uint32_t head_index{0};  // first live handle
+    uint32_t count{0};       // orders in the queue
+
+    bool empty() const { return count == 0; }
+    OrderHandle front() const { return handles[head_index]; }
+
+    template <typename F>
+    void ForEach(const OrderPool&, F&& f) const {
+        for (size_t i = head_index; i < handles.size(); i++) f(handles[i]);
+    }
+
+    void PushBack(OrderPool&, OrderHandle handle) {
+        handles.push_back(handle);
+        count++;
+    }
+
+    void Erase(OrderPool&, OrderHandle handle) {
+        if (handles[head_index] == handle) {
+            head_index++;
+        } else {
+            handles.erase(std::find(handles.begin() + head_index, handles.end(), handle));
+        }
+        count--;
+        if (count == 0) {
+            handles.clear();
+            head_index = 0;
+        } else if (head_index > count) {  // reclaim the consumed front once it outweighs the live handles
+            handles.erase(handles.begin(), handles.begin() + head_index);
+            head_index = 0;
+        }
+    }
+};
+
+/* OwnerOrderLists links the resting orders of every owner (OwnerId above 0) through the owner links of their pool
+ * nodes, oldest first, so the orders of one owner are found without touching the others. Indexed by owner id, the
+ * table grows to the highest owner seen.
+ */
+class OwnerOrderLists {
+   public:
+    void Insert(OrderPool& pool, OwnerId owner, OrderHandle handle) {
+        if (owner >= lists_.size()) lists_.resize(owner + 1);
+        OwnerList& list = lists_[owner];
+        OrderNodeCold& node = pool.Cold(handle);
+        node.owner_prev = list.tail;
+        node.owner_next = kNullOrderHandle;
+        if (list.tail == kNullOrderHandle) {
+            list.head = handle;
+        } else {
+            pool.Cold(list.tail).owner_next = handle;
+        }
+        list.tail = handle;
+        list.count++;
+    }
+
+    void Erase(OrderPool& pool, OwnerId owner, OrderHandle handle) {
+        OwnerList& list = lists_[owner];
+        const OrderNodeCold& node = pool.Cold(handle);
+        if (node.owner_prev == kNullOrderHandle) {
+            list.head = node.owner_next;
+        } else {
+            pool.Cold(node.owner_prev).owner_next = node.owner_next;
+        }
+        if (node.owner_next == kNullOrderHandle) {
+            list.tail = node.owner_prev;
+        } else {
+            pool.Cold(node.owner_next).owner_prev = node.owner_prev;
+        }
+        list.count--;
+    }
+
+    OrderHandle Head(OwnerId owner) const { return owner < lists_.size() ? lists_[owner].head : kNullOrderHandle; }
+    uint32_t Count(OwnerId owner) const { return owner < lists_.size() ? lists_[owner].count : 0; }
+
+   private:
+    struct OwnerList {
+        OrderHandle head{kNullOrderHandle};
+        OrderHandle tail{kNullOrderHandle};
+        uint32_t count{0};
+    };
+    std::vector<OwnerList> lists_;
+};
+
+#endif  // ORDER_POOL_HPP
@@ -0,0 +1,280 @@
+#ifndef PRICE_LADDER_HPP
+#define PRICE_LADDER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "fenwick_tree.hpp"
+#include "level.hpp"
+#include "occupancy_bitmap.hpp"
+
+/* PriceLadder holds the price levels of one side of the book in a contiguous array indexed by price - base.
+ * Instruments trade in a narrow tick band, so a window of a few thousand ticks covers every level and a lookup is a
+ * single array access instead of a tree walk. An OccupancyBitmap flags the non-empty levels, the best level and the
+ * next level are found with a few word scans.
+ * When a price falls outside the window the ladder recenters around the occupied range (growing the window if needed),
+ * this moves the Level objects, so references to levels are invalidated by FindOrCreate(). The window never grows past
+ * max_ticks: a level too far from the others to fit is kept in an overflow std::map instead, so any uint32_t price is
+ * accepted with bounded memory, and outliers only pay a tree lookup. No overflow level lies inside the window.
+ * A FenwickTree over the ticks keeps the cumulative depth, so the volume of a price range is O(log P). Quantity changes
+ * of a level therefore go through AddQuantity() and ReduceQuantity().
+ * Compare works like the comparator of a std::map: std::greater<> keeps the highest price first (bids),
+ * std::less<> keeps the lowest price first (asks). LevelT is the level type of the book, a BasicLevel<Queue>.
+ */
+template <typename Compare = std::less<>, typename LevelT = Level>
+class PriceLadder {
+    static constexpr bool kDescending = std::is_same_v<Compare, std::greater<>>;
+    using OverflowMap = std::map<uint32_t, LevelT, Compare>;
+
+   public:
+    static constexpr size_t kDefaultTicks = 4096;
+    static constexpr size_t kDefaultMaxTicks = size_t{1} << 18;
+
+    // Iterates over the window and the overflow levels in price order, best first.
+    class iterator {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = LevelT;
+        using difference_type = std::ptrdiff_t;
+        using pointer = LevelT*;
+        using reference = LevelT&;
+
+        iterator() = default;
+        iterator(PriceLadder* ladder, size_t index) : ladder_(ladder), index_(index) {
+            if (index_ == OccupancyBitmap::npos) overflow_ = ladder_->AfterWindow();
+        }
+        iterator(PriceLadder* ladder, typename OverflowMap::iterator overflow) : ladder_(ladder), overflow_(overflow) {}
+
+        LevelT& operator*() const {
+            return index_ != OccupancyBitmap::npos ? ladder_->levels_[index_] : overflow_->second;
+        }
+        LevelT* operator->() const { return &**this; }
+        iterator& operator++() {
+            if (index_ != OccupancyBitmap::npos) {
+                index_ = ladder_->NextIndex(index_);
+                if (index_ == OccupancyBitmap::npos) overflow_ = ladder_->AfterWindow();
+            } else {
+                bool before_window = ladder_->BeforeWindow(overflow_->first);
+                ++overflow_;
+                bool next_before_window =
+                    overflow_ != ladder_->overflow_.end() && ladder_->BeforeWindow(overflow_->first);
+                if (before_window && !next_before_window && !ladder_->occupied_.Empty()) {
+                    index_ = ladder_->BestIndex();  // the window comes between the overflow levels on both sides
+                }
+            }
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        bool operator==(const iterator& other) const {
+            return index_ == other.index_ && (index_ != OccupancyBitmap::npos || overflow_ == other.overflow_);
+        }
+
+       private:
+        PriceLadder* ladder_{nullptr};
+        size_t index_{OccupancyBitmap::npos};      // level in the window, npos for an overflow level or the end
+        typename OverflowMap::iterator overflow_;  // level in the overflow map when index_ is npos
+    };
+
+    explicit PriceLadder(size_t ticks = kDefaultTicks, size_t max_ticks = kDefaultMaxTicks)
+        : levels_(ticks), occupied_(ticks), depth_(ticks), max_ticks_(std::max(ticks, max_ticks)) {}
+
+    bool empty() const { return occupied_.Empty() && overflow_.empty(); }
+
+    // Iterate over the non-empty levels, best price first.
+    iterator begin() {
+        if (!overflow_.empty() && BeforeWindow(overflow_.begin()->first)) return {this, overflow_.begin()};
+        return {this, BestIndex()};
+    }
+    iterator end() { return {this, overflow_.end()}; }
+
+    // First non-empty level that is not better than price, same as std::map::lower_bound with Compare.
+    iterator lower_bound(uint32_t price) {
+        if (InWindow(price)) {
+            size_t index = price - base_;
+            return {this, kDescending ? occupied_.FindPrev(index) : occupied_.FindNext(index)};
+        }
+        auto overflow = overflow_.lower_bound(price);
+        if (BeforeWindow(price) && (overflow == overflow_.end() || !BeforeWindow(overflow->first))) {
+            return {this, BestIndex()};  // no overflow level left before the window, continue with the window
+        }
+        return {this, overflow};
+    }
+
+    // Best (first) non-empty level, the ladder must not be empty.
+    LevelT& Best() {
+        if (!overflow_.empty() && (occupied_.Empty() || BeforeWindow(overflow_.begin()->first))) {
+            return overflow_.begin()->second;
+        }
+        return levels_[BestIndex()];
+    }
+
+    // Level at price, nullptr if there are no orders at that price.
+    LevelT* Find(uint32_t price) {
+        if (!InWindow(price)) {
+            auto it = overflow_.find(price);
+            return it == overflow_.end() ? nullptr : &it->second;
+        }
+        size_t index = price - base_;
+        return occupied_.Test(index) ? &levels_[index] : nullptr;
+    }
+
+    // Level at price, an empty level is activated if needed. May recenter the window.
+    LevelT& FindOrCreate(uint32_t price) {
+        if (!InWindow(price) && !Recenter(price)) {
+            auto [it, inserted] = overflow_.try_emplace(price);
+            if (inserted) it->second.price = price;
+            return it->second;
+        }
+        size_t index = price - base_;
+        LevelT& level = levels_[index];
+        if (!occupied_.Test(index)) {
+            occupied_.Set(index);
+            level.price = price;
+        }
+        return level;
+    }
+
+    void AddQuantity(LevelT& level, uint32_t quantity) {
+        level.quantity += quantity;
+        if (InWindow(level.price)) {
+            depth_.Add(level.price - base_, quantity);
+        } else {
+            overflow_quantity_ += quantity;
+        }
+    }
+
+    void ReduceQuantity(LevelT& level, uint32_t quantity) {
+        level.quantity -= quantity;
+        if (InWindow(level.price)) {
+            depth_.Add(level.price - base_, -static_cast<int64_t>(quantity));
+        } else {
+            overflow_quantity_ -= quantity;
+        }
+    }
+
+    // Quantity resting between the prices low and high, both inclusive.
+    uint64_t VolumeBetween(uint32_t low, uint32_t high) const {
+        if (low > high) return 0;
+        uint64_t volume = 0;
+        if (high >= base_ && low < uint64_t{base_} + levels_.size()) {
+            size_t first = low < base_ ? 0 : low - base_;  // clamp the range to the window
+            size_t last = std::min<size_t>(high - base_, levels_.size() - 1);
+            volume = depth_.RangeSum(first, last);
+        }
+        if (overflow_quantity_ > 0) {
+            for (auto it = overflow_.lower_bound(kDescending ? high : low); it != overflow_.end(); ++it) {
+                if (kDescending ? it->first < low : it->first > high) break;
+                volume += it->second.quantity;
+            }
+        }
+        return volume;
+    }
+
+    // Quantity resting on every level of the ladder.
+    uint64_t TotalQuantity() const { return depth_.PrefixSum(levels_.size() - 1) + overflow_quantity_; }
+
+    // Release the level at price, it must not hold any orders.
+    void Remove(uint32_t price) {
+        if (!InWindow(price)) {
+            overflow_.erase(price);
+            return;
+        }
+        size_t index = price - base_;
+        occupied_.Clear(index);
+        levels_[index] = LevelT{};
+    }
+
+   private:
+    bool InWindow(uint32_t price) const { return price >= base_ && price - base_ < levels_.size(); }
+
+    // True for a price outside the window that comes before every level of the window in Compare order.
+    bool BeforeWindow(uint32_t price) const {
+        return kDescending ? price >= base_ && price - base_ >= levels_.size() : price < base_;
+    }
+
+    // First overflow level after the window in Compare order.
+    typename OverflowMap::iterator AfterWindow() {
+        if (kDescending) return base_ == 0 ? overflow_.end() : overflow_.lower_bound(base_ - 1);
+        uint64_t window_end = uint64_t{base_} + levels_.size();
+        return window_end > UINT32_MAX ? overflow_.end() : overflow_.lower_bound(static_cast<uint32_t>(window_end));
+    }
+
+    size_t BestIndex() const { return kDescending ? occupied_.FindLast() : occupied_.FindFirst(); }
+
+    size_t NextIndex(size_t index) const {
+        if (kDescending) return index == 0 ? OccupancyBitmap::npos : occupied_.FindPrev(index - 1);
+        return occupied_.FindNext(index + 1);
+    }
+
+    /*
+     * Move the window so that price and every occupied level of the window fit, with room to drift on both sides.
+     * The window doubles until it is at least twice the occupied span, up to max_ticks_. Returns false and leaves the
+     * window unchanged if the span does not fit, price then goes to the overflow levels. Overflow levels that fall in
+     * the new window move into it.
+     */
+    bool Recenter(uint32_t price) {
+        uint64_t low = price;
+        uint64_t high = price;
+        if (!occupied_.Empty()) {
+            low = std::min<uint64_t>(low, base_ + occupied_.FindFirst());
+            high = std::max<uint64_t>(high, base_ + occupied_.FindLast());
+        }
+        if (2 * (high - low + 1) > max_ticks_) {
+            return false;
+        }
+        size_t ticks = levels_.size();
+        while (ticks < 2 * (high - low + 1)) ticks *= 2;
+        ticks = std::min(ticks, max_ticks_);
+        uint64_t middle = (low + high) / 2;
+        uint32_t new_base = static_cast<uint32_t>(std::min<uint64_t>(middle > ticks / 2 ? middle - ticks / 2 : 0,
+                                                                     uint64_t{UINT32_MAX} + 1 - ticks));
+
+        std::vector<LevelT> new_levels(ticks);
+        OccupancyBitmap new_occupied(ticks);
+        depth_.Reset(ticks);
+        for (size_t i = occupied_.FindFirst(); i != OccupancyBitmap::npos; i = occupied_.FindNext(i + 1)) {
+            size_t new_index = base_ + i - new_base;
+            depth_.Add(new_index, levels_[i].quantity);
+            new_levels[new_index] = std::move(levels_[i]);  // orders are referenced by pool handles, levels move freely
+            new_occupied.Set(new_index);
+        }
+        levels_ = std::move(new_levels);
+        occupied_ = std::move(new_occupied);
+        base_ = new_base;
+
+        for (auto it = overflow_.begin(); it != overflow_.end();) {
+            if (!InWindow(it->first)) {
+                ++it;
+                continue;
+            }
+            size_t index = it->first - base_;
+            depth_.Add(index, it->second.quantity);
+            overflow_quantity_ -= it->second.quantity;
+            levels_[index] = std::move(it->second);
+            occupied_.Set(index);
+            it = overflow_.erase(it);
+        }
+        return true;
+    }
+
+    uint32_t base_{0};               // price of levels_[0]
+    std::vector<LevelT> levels_;     // one slot per tick, indexed by price - base_
+    OccupancyBitmap occupied_;       // bit set for every non-empty level
+    FenwickTree depth_;              // cumulative quantity over the ticks
+    size_t max_ticks_;               // the window never grows past this
+    OverflowMap overflow_;           // non-empty levels outside the window
+    uint64_t overflow_quantity_{0};  // quantity of the overflow levels
+};
+
+#endif  // PRICE_LADDER_HPP
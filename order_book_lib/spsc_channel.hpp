@@ -0,0 +1,214 @@
+#ifndef SPSC_CHANNEL_HPP
+#define SPSC_CHANNEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+inline constexpr size_t kCacheLineSize = 64;
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+/*
+ * Wait strategies of the SpscChannel. A side that cannot make progress calls Wait(ready) until ready() holds, the
+ * other side calls Notify() after every change that can make ready() true.
+ */
+
+// Burn the core, lowest hand-off latency. Only for a thread that owns a core.
+struct BusySpinWait {
+    template <typename Ready>
+    void Wait(Ready&& ready) {
+        while (!ready()) CpuRelax();
+    }
+    void Notify() {}
+};
+
+// Spin a little, then give the core away with yield. Default, good when threads share cores.
+struct SpinThenYieldWait {
+    static constexpr int kSpins = 256;
+
+    template <typename Ready>
+    void Wait(Ready&& ready) {
+        for (int i = 0; i < kSpins; i++) {
+            if (ready()) return;
+            CpuRelax();
+        }
+        while (!ready()) std::this_thread::yield();
+    }
+    void Notify() {}
+};
+
+// Spin a little, then park the thread in the kernel (futex on Linux, through std::atomic::wait). Notify() only
+// issues the wake up system call when the other side is parked.
+class FutexWait {
+   public:
+    static constexpr int kSpins = 256;
+
+    template <typename Ready>
+    void Wait(Ready&& ready) {
+        for (int i = 0; i < kSpins; i++) {
+            if (ready()) return;
+            CpuRelax();
+        }
+        while (!ready()) {
+            uint32_t signal = signal_.load(std::memory_order_acquire);
+            parked_.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);  // publish parked_ before checking ready() again
+            if (!ready()) {
+                signal_.wait(signal, std::memory_order_acquire);
+            }
+            parked_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // the change is visible before parked_ is read
+        if (parked_.load(std::memory_order_relaxed) > 0) {
+            signal_.fetch_add(1, std::memory_order_release);
+            signal_.notify_all();
+        }
+    }
+
+   private:
+    std::atomic<uint32_t> signal_{0};  // bumped on every wake up, the word the parked thread waits on
+    std::atomic<uint32_t> parked_{0};
+};
+
+/*
+ * Bounded single producer single consumer channel. Unlike a lossy queue, a full channel blocks the producer
+ * (backpressure) and no item is ever dropped. Items move in bulk: one index update and at most one wake up per batch.
+ * The producer calls Close() after its last item, the consumer drains the remaining items and then Pop() returns 0.
+ * Capacity is rounded up to a power of two. WaitStrategy chooses how a blocked side waits: BusySpinWait,
+ * SpinThenYieldWait or FutexWait.
+ */
+template <typename T, typename WaitStrategy = SpinThenYieldWait>
+class SpscChannel {
+   public:
+    explicit SpscChannel(size_t capacity) : slots_(std::bit_ceil(std::max<size_t>(capacity, 1))) {
+        if (capacity < 1) {
+            throw std::invalid_argument("Channel capacity must be more than zero.");
+        }
+        mask_ = slots_.size() - 1;
+    }
+
+    SpscChannel(const SpscChannel&) = delete;
+    SpscChannel& operator=(const SpscChannel&) = delete;
+
+    size_t Capacity() const { return slots_.size(); }
+
+    // Producer: push as many items as fit without waiting, returns the number pushed.
+    size_t TryPush(std::span<const T> items) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (producer_head_ + slots_.size() - tail < items.size()) {
+            producer_head_ = head_.load(std::memory_order_acquire);  // refresh the consumer position only when needed
+        }
+        size_t count = std::min<size_t>(items.size(), producer_head_ + slots_.size() - tail);
+        if (count == 0) {
+            return 0;
+        }
+        for (size_t i = 0; i < count; i++) {
+            slots_[(tail + i) & mask_] = items[i];
+        }
+        tail_.store(tail + count, std::memory_order_release);
+        data_wait_.Notify();
+        return count;
+    }
+
+    // Producer: push every item, waiting while the channel is full.
+    void Push(std::span<const T> items) {
+        while (!items.empty()) {
+            size_t count = TryPush(items);
+            if (count == 0) {
+                space_wait_.Wait([this] {
+                    uint64_t head = head_.load(std::memory_order_acquire);
+                    return head + slots_.size() != tail_.load(std::memory_order_relaxed);
+                });
+            }
+            items = items.subspan(count);
+        }
+    }
+
+    void Push(const T& item) { Push(std::span<const T>(&item, 1)); }
+
+    // Producer: no more items will be pushed.
+    void Close() {
+        closed_.store(true, std::memory_order_release);
+        data_wait_.Notify();
+    }
+
+    // Consumer: true once the producer closed the channel. Items pushed before Close() may still be queued, a TryPop()
+    // that returns 0 after Closed() returned true means the channel is drained.
+    bool Closed() const { return closed_.load(std::memory_order_acquire); }
+
+    // Consumer: pop up to out.size() items without waiting, returns the number popped.
+    size_t TryPop(std::span<T> out) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (consumer_tail_ - head < out.size()) {
+            consumer_tail_ = tail_.load(std::memory_order_acquire);  // refresh the producer position only when needed
+        }
+        size_t count = std::min<size_t>(out.size(), consumer_tail_ - head);
+        if (count == 0) {
+            return 0;
+        }
+        for (size_t i = 0; i < count; i++) {
+            out[i] = slots_[(head + i) & mask_];
+        }
+        head_.store(head + count, std::memory_order_release);
+        space_wait_.Notify();
+        return count;
+    }
+
+    // Consumer: pop up to out.size() items, waiting for at least one. Returns 0 once the channel is closed and
+    // drained (or out is empty).
+    size_t Pop(std::span<T> out) {
+        if (out.empty()) {
+            return 0;
+        }
+        while (true) {
+            size_t count = TryPop(out);
+            if (count > 0) {
+                return count;
+            }
+            if (closed_.load(std::memory_order_acquire)) {
+                return TryPop(out);  // items pushed before Close()
+            }
+            data_wait_.Wait([this] {
+                return tail_.load(std::memory_order_acquire) != head_.load(std::memory_order_relaxed) ||
+                       closed_.load(std::memory_order_acquire);
+            });
+        }
+    }
+
+    bool Pop(T& item) { return Pop(std::span<T>(&item, 1)) == 1; }
+
+   private:
+    // Producer side: its position and its last view of the consumer position.
+    alignas(kCacheLineSize) std::atomic<uint64_t> tail_{0};
+    uint64_t producer_head_{0};
+
+    // Consumer side.
+    alignas(kCacheLineSize) std::atomic<uint64_t> head_{0};
+    uint64_t consumer_tail_{0};
+
+    alignas(kCacheLineSize) std::atomic<bool> closed_{false};
+    // The consumer waits for items, the producer waits for room.
+    WaitStrategy data_wait_;
+    alignas(kCacheLineSize) WaitStrategy space_wait_;
+
+    alignas(kCacheLineSize) std::vector<T> slots_;
+    size_t mask_;
+};
+
+#endif  // SPSC_CHANNEL_HPP
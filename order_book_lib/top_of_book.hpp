@@ -0,0 +1,84 @@
+#ifndef TOP_OF_BOOK_HPP
+#define TOP_OF_BOOK_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "spsc_channel.hpp"
+
+// Best bid and ask of a book, 0 price and quantity for an empty side.
+struct TopOfBook {
+    uint32_t bid_price{0};
+    uint32_t bid_quantity{0};
+    uint32_t ask_price{0};
+    uint32_t ask_quantity{0};
+    uint64_t sequence{0};  // number of the book message that produced this top, counted from 1
+
+    bool SameQuotes(const TopOfBook& other) const {
+        return bid_price == other.bid_price && bid_quantity == other.bid_quantity && ask_price == other.ask_price &&
+               ask_quantity == other.ask_quantity;
+    }
+};
+
+/*
+ * Seqlock holding the latest TopOfBook of a book, written by the matching thread and read by any number of threads.
+ * The writer bumps the version to odd, stores the fields and bumps it back to even; it never waits for the readers,
+ * and a reader never writes, so polling readers cause no cache line ping-pong with each other and the writer only
+ * loses the line when it is actually read. A reader that sees an odd version, or a version that changed while it
+ * copied the fields, took a torn copy and tries again. The fields are relaxed atomics so the racing copy is not a data
+ * race. The cell takes its own cache line so it does not share one with the book.
+ */
+class alignas(kCacheLineSize) TopOfBookCell {
+   public:
+    // Writer (the matching thread) only.
+    void Publish(const TopOfBook& top) {
+        uint64_t version = version_.load(std::memory_order_relaxed);
+        version_.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);  // the odd version is visible before any field
+        bid_.store(Pack(top.bid_price, top.bid_quantity), std::memory_order_relaxed);
+        ask_.store(Pack(top.ask_price, top.ask_quantity), std::memory_order_relaxed);
+        sequence_.store(top.sequence, std::memory_order_relaxed);
+        version_.store(version + 2, std::memory_order_release);
+    }
+
+    // One attempt to copy a consistent top into top, wait-free. False if a publish was in progress.
+    bool TryRead(TopOfBook& top) const {
+        uint64_t version = version_.load(std::memory_order_acquire);
+        if (version & 1) {
+            return false;
+        }
+        uint64_t bid = bid_.load(std::memory_order_relaxed);
+        uint64_t ask = ask_.load(std::memory_order_relaxed);
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);  // the fields are read before the version check
+        if (version_.load(std::memory_order_relaxed) != version) {
+            return false;
+        }
+        top = {High(bid), Low(bid), High(ask), Low(ask), sequence};
+        return true;
+    }
+
+    // Copy a consistent top, retrying while publishes overlap the copy.
+    TopOfBook Read() const {
+        TopOfBook top;
+        while (!TryRead(top)) {
+            CpuRelax();
+        }
+        return top;
+    }
+
+    // Number of publishes so far.
+    uint64_t PublishCount() const { return version_.load(std::memory_order_acquire) / 2; }
+
+   private:
+    static uint64_t Pack(uint32_t price, uint32_t quantity) { return (uint64_t{price} << 32) | quantity; }
+    static uint32_t High(uint64_t value) { return static_cast<uint32_t>(value >> 32); }
+    static uint32_t Low(uint64_t value) { return static_cast<uint32_t>(value); }
+
+    std::atomic<uint64_t> version_{0};  // odd while a publish is in progress
+    std::atomic<uint64_t> bid_{0};
+    std::atomic<uint64_t> ask_{0};
+    std::atomic<uint64_t> sequence_{0};
+};
+
+#endif  // TOP_OF_BOOK_HPP